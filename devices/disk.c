@@ -32,6 +32,7 @@
 #define STA_BSY 0x80            /* Busy. */
 #define STA_DRDY 0x40           /* Device Ready. */
 #define STA_DRQ 0x08            /* Data Request. */
+#define STA_ERR 0x01            /* Error. */
 
 /* Control Register bits. */
 #define CTL_SRST 0x04           /* Software Reset. */
@@ -47,6 +48,9 @@
 #define CMD_IDENTIFY_DEVICE 0xec        /* IDENTIFY DEVICE. */
 #define CMD_READ_SECTOR_RETRY 0x20      /* READ SECTOR with retries. */
 #define CMD_WRITE_SECTOR_RETRY 0x30     /* WRITE SECTOR with retries. */
+#define CMD_READ_MULTIPLE 0xc4          /* READ MULTIPLE. */
+#define CMD_WRITE_MULTIPLE 0xc5         /* WRITE MULTIPLE. */
+#define CMD_SET_MULTIPLE_MODE 0xc6      /* SET MULTIPLE MODE. */
 
 /* An ATA device. */
 struct disk {
@@ -56,9 +60,13 @@ struct disk {
 
 	bool is_ata;                /* 1=This device is an ATA disk. */
 	disk_sector_t capacity;     /* Capacity in sectors (if is_ata). */
+	size_t multiple;            /* Sectors per DRQ block of READ/WRITE
+								   MULTIPLE, or 0 if not supported. */
 
 	long long read_cnt;         /* Number of sectors read. */
 	long long write_cnt;        /* Number of sectors written. */
+	long long read_cmd_cnt;     /* Number of read commands. */
+	long long write_cmd_cnt;    /* Number of write commands. */
 };
 
 /* An ATA channel (aka controller).
@@ -83,11 +91,13 @@ static struct channel channels[CHANNEL_CNT];
 static void reset_channel (struct channel *);
 static bool check_device_type (struct disk *);
 static void identify_ata_device (struct disk *);
+static void set_multiple_mode (struct disk *, size_t cnt);
 
-static void select_sector (struct disk *, disk_sector_t);
+static void select_sectors (struct disk *, disk_sector_t, size_t cnt);
 static void issue_pio_command (struct channel *, uint8_t command);
 static void input_sector (struct channel *, void *);
 static void output_sector (struct channel *, const void *);
+static size_t block_size (const struct disk *, size_t cnt);
 
 static void wait_until_idle (const struct disk *);
 static bool wait_while_busy (const struct disk *);
@@ -132,8 +142,10 @@ disk_init (void) {
 
 			d->is_ata = false;
 			d->capacity = 0;
+			d->multiple = 0;
 
 			d->read_cnt = d->write_cnt = 0;
+			d->read_cmd_cnt = d->write_cmd_cnt = 0;
 		}
 
 		/* Register interrupt handler. */
@@ -167,8 +179,10 @@ disk_print_stats (void) {
 		for (dev_no = 0; dev_no < 2; dev_no++) {
 			struct disk *d = disk_get (chan_no, dev_no);
 			if (d != NULL && d->is_ata)
-				printf ("%s: %lld reads, %lld writes\n",
-						d->name, d->read_cnt, d->write_cnt);
+				printf ("%s: %lld reads, %lld writes, "
+						"in %lld and %lld commands\n",
+						d->name, d->read_cnt, d->write_cnt,
+						d->read_cmd_cnt, d->write_cmd_cnt);
 		}
 	}
 }
@@ -209,47 +223,103 @@ disk_size (struct disk *d) {
    per-disk locking is unneeded. */
 void
 disk_read (struct disk *d, disk_sector_t sec_no, void *buffer) {
+	disk_read_multi (d, sec_no, 1, buffer);
+}
+
+/* Write sector SEC_NO to disk D from BUFFER, which must contain
+   DISK_SECTOR_SIZE bytes.  Returns after the disk has
+   acknowledged receiving the data.
+   Internally synchronizes accesses to disks, so external
+   per-disk locking is unneeded. */
+void
+disk_write (struct disk *d, disk_sector_t sec_no, const void *buffer) {
+	disk_write_multi (d, sec_no, 1, buffer);
+}
+
+/* Reads CNT consecutive sectors starting at SEC_NO from disk D
+   into BUFFER, which must have room for CNT * DISK_SECTOR_SIZE
+   bytes.  CNT must be between 1 and DISK_MULTI_MAX.  The whole
+   run is transferred with a single command: READ MULTIPLE if the
+   disk supports it, so that the device interrupts once per block
+   of sectors, and otherwise READ SECTOR, which interrupts once
+   per sector.
+   Internally synchronizes accesses to disks, so external
+   per-disk locking is unneeded. */
+void
+disk_read_multi (struct disk *d, disk_sector_t sec_no, size_t cnt,
+		void *buffer) {
 	struct channel *c;
+	uint8_t *p = buffer;
+	size_t block;
+	size_t i, j;
 
 	ASSERT (d != NULL);
 	ASSERT (buffer != NULL);
+	ASSERT (cnt > 0 && cnt <= DISK_MULTI_MAX);
 
 	c = d->channel;
+	block = block_size (d, cnt);
 	lock_acquire (&c->lock);
-	select_sector (d, sec_no);
-	issue_pio_command (c, CMD_READ_SECTOR_RETRY);
-	sema_down (&c->completion_wait);
-	if (!wait_while_busy (d))
-		PANIC ("%s: disk read failed, sector=%"PRDSNu, d->name, sec_no);
-	input_sector (c, buffer);
-	d->read_cnt++;
+	select_sectors (d, sec_no, cnt);
+	issue_pio_command (c, block > 1 ? CMD_READ_MULTIPLE
+			: CMD_READ_SECTOR_RETRY);
+	for (i = 0; i < cnt; i += block) {
+		/* One interrupt per block; the last may be short. */
+		sema_down (&c->completion_wait);
+		if (!wait_while_busy (d))
+			PANIC ("%s: disk read failed, sector=%"PRDSNu,
+					d->name, sec_no + (disk_sector_t) i);
+		for (j = i; j < i + block && j < cnt; j++)
+			input_sector (c, p + j * DISK_SECTOR_SIZE);
+	}
+	d->read_cnt += cnt;
+	d->read_cmd_cnt++;
 	lock_release (&c->lock);
 }
 
-/* Write sector SEC_NO to disk D from BUFFER, which must contain
-   DISK_SECTOR_SIZE bytes.  Returns after the disk has
-   acknowledged receiving the data.
+/* Writes CNT consecutive sectors starting at SEC_NO to disk D
+   from BUFFER, which must contain CNT * DISK_SECTOR_SIZE bytes.
+   CNT must be between 1 and DISK_MULTI_MAX.  The whole run is
+   transferred with a single WRITE MULTIPLE command if the disk
+   supports it, and otherwise WRITE SECTOR.  Returns after
+   the disk has acknowledged receiving the data.
    Internally synchronizes accesses to disks, so external
    per-disk locking is unneeded. */
 void
-disk_write (struct disk *d, disk_sector_t sec_no, const void *buffer) {
+disk_write_multi (struct disk *d, disk_sector_t sec_no, size_t cnt,
+		const void *buffer) {
 	struct channel *c;
+	const uint8_t *p = buffer;
+	size_t block;
+	size_t i, j;
 
 	ASSERT (d != NULL);
 	ASSERT (buffer != NULL);
+	ASSERT (cnt > 0 && cnt <= DISK_MULTI_MAX);
 
 	c = d->channel;
+	block = block_size (d, cnt);
 	lock_acquire (&c->lock);
-	select_sector (d, sec_no);
-	issue_pio_command (c, CMD_WRITE_SECTOR_RETRY);
-	if (!wait_while_busy (d))
-		PANIC ("%s: disk write failed, sector=%"PRDSNu, d->name, sec_no);
-	output_sector (c, buffer);
+	select_sectors (d, sec_no, cnt);
+	issue_pio_command (c, block > 1 ? CMD_WRITE_MULTIPLE
+			: CMD_WRITE_SECTOR_RETRY);
+	for (i = 0; i < cnt; i += block) {
+		/* The device asks for every block after the first with an
+		   interrupt. */
+		if (i > 0)
+			sema_down (&c->completion_wait);
+		if (!wait_while_busy (d))
+			PANIC ("%s: disk write failed, sector=%"PRDSNu,
+					d->name, sec_no + (disk_sector_t) i);
+		for (j = i; j < i + block && j < cnt; j++)
+			output_sector (c, p + j * DISK_SECTOR_SIZE);
+	}
 	sema_down (&c->completion_wait);
-	d->write_cnt++;
+	d->write_cnt += cnt;
+	d->write_cmd_cnt++;
 	lock_release (&c->lock);
 }
-
+
 /* Disk detection and identification. */
 
 static void print_ata_string (char *string, size_t size);
@@ -364,6 +434,11 @@ identify_ata_device (struct disk *d) {
 	/* Calculate capacity. */
 	d->capacity = id[60] | ((uint32_t) id[61] << 16);
 
+	/* Word 47 gives the most sectors per DRQ block that READ/WRITE
+	   MULTIPLE supports, if any.  Use that many. */
+	if ((id[47] & 0xff) > 1)
+		set_multiple_mode (d, id[47] & 0xff);
+
 	/* Print identification message. */
 	printf ("%s: detected %'"PRDSNu" sector (", d->name, d->capacity);
 	if (d->capacity > 1024 / DISK_SECTOR_SIZE * 1024 * 1024)
@@ -382,6 +457,21 @@ identify_ata_device (struct disk *d) {
 	printf ("\"\n");
 }
 
+/* Sends a SET MULTIPLE MODE command to disk D to make READ/WRITE
+   MULTIPLE move CNT sectors per DRQ block.  Sets D's multiple
+   member to CNT on success and to 0 if the disk refuses. */
+static void
+set_multiple_mode (struct disk *d, size_t cnt) {
+	struct channel *c = d->channel;
+
+	select_device_wait (d);
+	outb (reg_nsect (c), cnt);
+	issue_pio_command (c, CMD_SET_MULTIPLE_MODE);
+	sema_down (&c->completion_wait);
+	wait_while_busy (d);
+	d->multiple = inb (reg_alt_status (c)) & STA_ERR ? 0 : cnt;
+}
+
 /* Prints STRING, which consists of SIZE bytes in a funky format:
    each pair of bytes is in reverse order.  Does not print
    trailing whitespace and/or nulls. */
@@ -402,17 +492,19 @@ print_ata_string (char *string, size_t size) {
 }
 
 /* Selects device D, waiting for it to become ready, and then
-   writes SEC_NO to the disk's sector selection registers.  (We
-   use LBA mode.) */
+   writes SEC_NO and the sector count CNT to the disk's sector
+   selection registers.  (We use LBA mode.)  A count register
+   value of 0 means 256 sectors. */
 static void
-select_sector (struct disk *d, disk_sector_t sec_no) {
+select_sectors (struct disk *d, disk_sector_t sec_no, size_t cnt) {
 	struct channel *c = d->channel;
 
-	ASSERT (sec_no < d->capacity);
-	ASSERT (sec_no < (1UL << 28));
+	ASSERT (cnt > 0 && cnt <= DISK_MULTI_MAX);
+	ASSERT (sec_no + cnt <= d->capacity);
+	ASSERT (sec_no + cnt <= (1UL << 28));
 
 	select_device_wait (d);
-	outb (reg_nsect (c), 1);
+	outb (reg_nsect (c), cnt == DISK_MULTI_MAX ? 0 : cnt);
 	outb (reg_lbal (c), sec_no);
 	outb (reg_lbam (c), sec_no >> 8);
 	outb (reg_lbah (c), (sec_no >> 16));
@@ -445,6 +537,15 @@ static void
 output_sector (struct channel *c, const void *sector) {
 	outsw (reg_data (c), sector, DISK_SECTOR_SIZE / 2);
 }
+
+/* Returns the number of sectors that a transfer of CNT sectors
+   on disk D moves per interrupt: D's DRQ block size for READ/WRITE
+   MULTIPLE, or 1 for READ/WRITE SECTOR.  A single sector always
+   uses the latter. */
+static size_t
+block_size (const struct disk *d, size_t cnt) {
+	return cnt > 1 && d->multiple > 1 ? d->multiple : 1;
+}
 
 /* Low-level ATA primitives. */
 
@@ -0,0 +1,180 @@
+/* dcache.c: Cache of directory entries for path lookup.
+ *
+ * Maps a name in a directory, keyed by the sector of the directory's
+ * inode, to the sector of the named file's inode, so that looking up
+ * a name again needs no search of the directory.  Names found not to
+ * exist are cached too, as negative entries, since build jobs and
+ * the like probe for many files that are not there.
+ *
+ * directory.c keeps the cache up to date: adding a name replaces any
+ * entry for it, and removing a name leaves a negative entry behind.
+ * When a directory itself is removed, its entries are dropped, so
+ * that they cannot be found under a later directory that reuses its
+ * inode sector.
+ *
+ * At most DCACHE_SIZE entries are kept; beyond that the least
+ * recently used one is reused.  DCACHE_LOCK protects everything
+ * here. */
+
+#include "filesys/dcache.h"
+#include <debug.h>
+#include <hash.h>
+#include <list.h>
+#include <stdio.h>
+#include <string.h>
+#include "filesys/directory.h"
+#include "threads/malloc.h"
+#include "threads/synch.h"
+
+/* Most cached entries. */
+#define DCACHE_SIZE 256
+
+/* A cached directory entry. */
+struct dentry {
+	struct hash_elem hash_elem;         /* Element in DENTRIES. */
+	struct list_elem lru_elem;          /* Element in LRU. */
+	disk_sector_t dir;                  /* Directory's inode sector. */
+	disk_sector_t sector;               /* File's, or DCACHE_NEGATIVE. */
+	char name[NAME_MAX + 1];            /* Null terminated file name. */
+};
+
+static struct hash dentries;            /* Entries by directory and name. */
+static struct list lru;                 /* Most recently used first. */
+static size_t dentry_cnt;               /* Entries in DENTRIES. */
+static struct lock dcache_lock;
+
+/* Statistics. */
+static long long hit_cnt;               /* Lookups answered. */
+static long long negative_cnt;          /* ...with "no such file". */
+static long long miss_cnt;              /* Lookups not answered. */
+
+static uint64_t
+dentry_hash (const struct hash_elem *e, void *aux UNUSED) {
+	const struct dentry *d = hash_entry (e, struct dentry, hash_elem);
+
+	return hash_string (d->name) ^ hash_int (d->dir);
+}
+
+static bool
+dentry_less (const struct hash_elem *a_, const struct hash_elem *b_,
+		void *aux UNUSED) {
+	const struct dentry *a = hash_entry (a_, struct dentry, hash_elem);
+	const struct dentry *b = hash_entry (b_, struct dentry, hash_elem);
+
+	if (a->dir != b->dir)
+		return a->dir < b->dir;
+	return strcmp (a->name, b->name) < 0;
+}
+
+/* Initializes the dentry cache. */
+void
+dcache_init (void) {
+	hash_init (&dentries, dentry_hash, dentry_less, NULL);
+	list_init (&lru);
+	dentry_cnt = 0;
+	lock_init (&dcache_lock);
+}
+
+/* Prints dentry cache statistics. */
+void
+dcache_print_stats (void) {
+	long long lookups = hit_cnt + miss_cnt;
+
+	printf ("Dcache: %lld hits (%lld negative), %lld misses, "
+			"%lld%% hit rate\n",
+			hit_cnt, negative_cnt, miss_cnt,
+			lookups ? hit_cnt * 100 / lookups : 0);
+}
+
+/* Returns the entry for NAME in DIR, or a null pointer.
+ * Must be called with DCACHE_LOCK held. */
+static struct dentry *
+dentry_find (disk_sector_t dir, const char *name) {
+	struct dentry key;
+	struct hash_elem *e;
+
+	if (strlen (name) > NAME_MAX)
+		return NULL;
+	key.dir = dir;
+	strlcpy (key.name, name, sizeof key.name);
+	e = hash_find (&dentries, &key.hash_elem);
+	return e != NULL ? hash_entry (e, struct dentry, hash_elem) : NULL;
+}
+
+/* Looks up NAME in the directory whose inode is in sector DIR.  On a
+ * hit, returns true and sets *SECTORP to the sector of the file's
+ * inode, or to DCACHE_NEGATIVE if the file is known not to exist.
+ * Returns false on a miss. */
+bool
+dcache_lookup (disk_sector_t dir, const char *name, disk_sector_t *sectorp) {
+	struct dentry *d;
+
+	lock_acquire (&dcache_lock);
+	d = dentry_find (dir, name);
+	if (d != NULL) {
+		list_remove (&d->lru_elem);
+		list_push_front (&lru, &d->lru_elem);
+		*sectorp = d->sector;
+		hit_cnt++;
+		if (d->sector == DCACHE_NEGATIVE)
+			negative_cnt++;
+	} else
+		miss_cnt++;
+	lock_release (&dcache_lock);
+	return d != NULL;
+}
+
+/* Records that NAME in the directory whose inode is in sector DIR is
+ * the file whose inode is in SECTOR, or does not exist if SECTOR is
+ * DCACHE_NEGATIVE, replacing anything known about it before. */
+void
+dcache_insert (disk_sector_t dir, const char *name, disk_sector_t sector) {
+	struct dentry *d;
+
+	if (strlen (name) > NAME_MAX)
+		return;
+
+	lock_acquire (&dcache_lock);
+	d = dentry_find (dir, name);
+	if (d != NULL)
+		list_remove (&d->lru_elem);
+	else {
+		if (dentry_cnt < DCACHE_SIZE && (d = malloc (sizeof *d)) != NULL)
+			dentry_cnt++;
+		else if (!list_empty (&lru)) {
+			/* Reuse the least recently used entry. */
+			d = list_entry (list_pop_back (&lru), struct dentry, lru_elem);
+			hash_delete (&dentries, &d->hash_elem);
+		} else {
+			lock_release (&dcache_lock);
+			return;
+		}
+		d->dir = dir;
+		strlcpy (d->name, name, sizeof d->name);
+		hash_insert (&dentries, &d->hash_elem);
+	}
+	d->sector = sector;
+	list_push_front (&lru, &d->lru_elem);
+	lock_release (&dcache_lock);
+}
+
+/* Drops every entry for a name in the directory whose inode is in
+ * sector DIR, which is being removed. */
+void
+dcache_invalidate_dir (disk_sector_t dir) {
+	struct list_elem *e;
+
+	lock_acquire (&dcache_lock);
+	for (e = list_begin (&lru); e != list_end (&lru); ) {
+		struct dentry *d = list_entry (e, struct dentry, lru_elem);
+
+		e = list_next (e);
+		if (d->dir == dir) {
+			list_remove (&d->lru_elem);
+			hash_delete (&dentries, &d->hash_elem);
+			free (d);
+			dentry_cnt--;
+		}
+	}
+	lock_release (&dcache_lock);
+}
@@ -1,15 +1,31 @@
 #include "filesys/directory.h"
 #include <stdio.h>
 #include <string.h>
+#include <hash.h>
 #include <list.h>
+#include "filesys/dcache.h"
 #include "filesys/filesys.h"
 #include "filesys/inode.h"
 #include "threads/malloc.h"
 
+/* A directory is stored in one of two formats, told apart by the
+ * header at its start.
+ *
+ * A small directory is linear: an array of entries after the
+ * header, searched one entry at a time.
+ *
+ * Once it outgrows DIR_LINEAR_MAX entries it is converted to a
+ * hashed directory: the header sector is followed by BUCKET_CNT
+ * buckets of one sector each, and a name is kept in bucket
+ * hash (name) % BUCKET_CNT, so that finding it takes one sector
+ * read however large the directory.  When a name's bucket is full,
+ * the number of buckets doubles and each bucket splits in two, the
+ * way a hash table grows in memory. */
+
 /* A directory. */
 struct dir {
 	struct inode *inode;                /* Backing store. */
-	off_t pos;                          /* Current position. */
+	off_t pos;                          /* Current position, in entries. */
 };
 
 /* A single directory entry. */
@@ -19,11 +35,47 @@ struct dir_entry {
 	bool in_use;                        /* In use or free? */
 };
 
+/* Start of every directory. */
+struct dir_header {
+	uint32_t bucket_cnt;                /* Buckets, 0 if linear. */
+	uint32_t unused;                    /* Not used. */
+};
+
+/* Entries in a bucket. */
+#define BUCKET_ENTRIES 25
+
+/* A bucket of a hashed directory.
+ * Must be exactly DISK_SECTOR_SIZE bytes long. */
+struct dir_bucket {
+	struct dir_entry entries[BUCKET_ENTRIES];
+	uint8_t unused[12];                 /* Not used. */
+};
+
+/* Most entries in a linear directory. */
+#define DIR_LINEAR_MAX 32
+
+/* Buckets of a newly hashed directory, and most buckets.  Both are
+ * powers of 2. */
+#define DIR_MIN_BUCKETS 4
+#define DIR_MAX_BUCKETS 4096
+
+/* Offset of linear entry IDX. */
+#define LINEAR_OFS(IDX) \
+	((off_t) (sizeof (struct dir_header) + (IDX) * sizeof (struct dir_entry)))
+
+/* Offset of bucket IDX, and of entry SLOT in it. */
+#define BUCKET_OFS(IDX) ((off_t) ((IDX) + 1) * DISK_SECTOR_SIZE)
+#define ENTRY_OFS(IDX, SLOT) \
+	(BUCKET_OFS (IDX) + (off_t) ((SLOT) * sizeof (struct dir_entry)))
+
 /* Creates a directory with space for ENTRY_CNT entries in the
  * given SECTOR.  Returns true if successful, false on failure. */
 bool
 dir_create (disk_sector_t sector, size_t entry_cnt) {
-	return inode_create (sector, entry_cnt * sizeof (struct dir_entry));
+	ASSERT (sizeof (struct dir_bucket) == DISK_SECTOR_SIZE);
+
+	/* An all-zero header marks the directory linear. */
+	return inode_create (sector, LINEAR_OFS (entry_cnt));
 }
 
 /* Opens and returns the directory for the given INODE, of which
@@ -71,6 +123,30 @@ dir_get_inode (struct dir *dir) {
 	return dir->inode;
 }
 
+/* Returns the number of buckets in DIR, 0 if it is linear. */
+static size_t
+bucket_cnt (const struct dir *dir) {
+	struct dir_header h;
+
+	if (inode_read_at (dir->inode, &h, sizeof h, 0) != sizeof h)
+		return 0;
+	return h.bucket_cnt;
+}
+
+/* Reads bucket IDX of DIR into B.  Returns false on a short read. */
+static bool
+read_bucket (const struct dir *dir, size_t idx, struct dir_bucket *b) {
+	return inode_read_at (dir->inode, b, sizeof *b, BUCKET_OFS (idx))
+		== sizeof *b;
+}
+
+/* Writes B as bucket IDX of DIR.  Returns false on a short write. */
+static bool
+write_bucket (struct dir *dir, size_t idx, const struct dir_bucket *b) {
+	return inode_write_at (dir->inode, b, sizeof *b, BUCKET_OFS (idx))
+		== sizeof *b;
+}
+
 /* Searches DIR for a file with the given NAME.
  * If successful, returns true, sets *EP to the directory entry
  * if EP is non-null, and sets *OFSP to the byte offset of the
@@ -79,13 +155,34 @@ dir_get_inode (struct dir *dir) {
 static bool
 lookup (const struct dir *dir, const char *name,
 		struct dir_entry *ep, off_t *ofsp) {
+	size_t buckets = bucket_cnt (dir);
 	struct dir_entry e;
 	size_t ofs;
 
 	ASSERT (dir != NULL);
 	ASSERT (name != NULL);
 
-	for (ofs = 0; inode_read_at (dir->inode, &e, sizeof e, ofs) == sizeof e;
+	if (buckets != 0) {
+		/* Hashed: only NAME's bucket can hold it. */
+		size_t idx = hash_string (name) & (buckets - 1);
+		struct dir_bucket b;
+		size_t i;
+
+		if (!read_bucket (dir, idx, &b))
+			return false;
+		for (i = 0; i < BUCKET_ENTRIES; i++)
+			if (b.entries[i].in_use && !strcmp (name, b.entries[i].name)) {
+				if (ep != NULL)
+					*ep = b.entries[i];
+				if (ofsp != NULL)
+					*ofsp = ENTRY_OFS (idx, i);
+				return true;
+			}
+		return false;
+	}
+
+	for (ofs = LINEAR_OFS (0);
+			inode_read_at (dir->inode, &e, sizeof e, ofs) == sizeof e;
 			ofs += sizeof e)
 		if (e.in_use && !strcmp (name, e.name)) {
 			if (ep != NULL)
@@ -104,19 +201,136 @@ lookup (const struct dir *dir, const char *name,
 bool
 dir_lookup (const struct dir *dir, const char *name,
 		struct inode **inode) {
+	disk_sector_t parent = inode_get_inumber (dir->inode);
+	disk_sector_t sector;
 	struct dir_entry e;
 
 	ASSERT (dir != NULL);
 	ASSERT (name != NULL);
 
-	if (lookup (dir, name, &e, NULL))
-		*inode = inode_open (e.inode_sector);
+	/* Search the directory only if the dentry cache does not know
+	 * the answer, and tell it what was found. */
+	inode_lock_dir (dir->inode);
+	if (!dcache_lookup (parent, name, &sector)) {
+		sector = lookup (dir, name, &e, NULL) ? e.inode_sector : DCACHE_NEGATIVE;
+		dcache_insert (parent, name, sector);
+	}
+
+	if (sector != DCACHE_NEGATIVE)
+		*inode = inode_open (sector);
 	else
 		*inode = NULL;
+	inode_unlock_dir (dir->inode);
 
 	return *inode != NULL;
 }
 
+/* Converts DIR, a linear directory with ENTRY_CNT slots, to a hashed
+ * one, with enough buckets that no bucket overflows.  Returns false
+ * if memory or disk is short, leaving DIR as it was. */
+static bool
+hash_linear (struct dir *dir, size_t entry_cnt) {
+	struct dir_entry *entries;
+	struct dir_bucket *buckets = NULL;
+	struct dir_header h = { .bucket_cnt = DIR_MIN_BUCKETS };
+	bool success = false;
+	size_t i;
+
+	entries = malloc (entry_cnt * sizeof *entries);
+	if (entries == NULL)
+		return false;
+	if (inode_read_at (dir->inode, entries, entry_cnt * sizeof *entries,
+				LINEAR_OFS (0)) != (off_t) (entry_cnt * sizeof *entries))
+		goto done;
+
+	/* Lay the buckets out in memory, doubling their number until
+	 * every entry fits. */
+	for (;;) {
+		free (buckets);
+		buckets = calloc (h.bucket_cnt, sizeof *buckets);
+		if (buckets == NULL)
+			goto done;
+		for (i = 0; i < entry_cnt; i++) {
+			struct dir_bucket *b;
+			size_t slot;
+
+			if (!entries[i].in_use)
+				continue;
+			b = &buckets[hash_string (entries[i].name) & (h.bucket_cnt - 1)];
+			for (slot = 0; slot < BUCKET_ENTRIES; slot++)
+				if (!b->entries[slot].in_use)
+					break;
+			if (slot == BUCKET_ENTRIES)
+				break;
+			b->entries[slot] = entries[i];
+		}
+		if (i == entry_cnt)
+			break;
+		h.bucket_cnt *= 2;
+	}
+
+	/* Write the last bucket first, so that a full disk is found
+	 * before the linear entries are overwritten. */
+	for (i = h.bucket_cnt; i-- > 0; )
+		if (!write_bucket (dir, i, &buckets[i]))
+			goto done;
+	success = inode_write_at (dir->inode, &h, sizeof h, 0) == sizeof h;
+
+done:
+	free (buckets);
+	free (entries);
+	return success;
+}
+
+/* Doubles the buckets of DIR, a hashed directory with BUCKETS
+ * buckets, moving each entry of bucket I whose hash says so to
+ * bucket I + BUCKETS.  Returns false if memory or disk is short, or
+ * DIR has as many buckets as it may, leaving DIR as it was. */
+static bool
+split_buckets (struct dir *dir, size_t buckets) {
+	struct dir_bucket *lo, *hi;
+	struct dir_header h = { .bucket_cnt = buckets * 2 };
+	bool success = false;
+	size_t i, j, k;
+
+	if (buckets >= DIR_MAX_BUCKETS)
+		return false;
+	lo = malloc (sizeof *lo);
+	hi = calloc (1, sizeof *hi);
+	if (lo == NULL || hi == NULL)
+		goto done;
+
+	/* Make room for the new buckets before moving anything, so that
+	 * a full disk leaves the directory as it was. */
+	if (!write_bucket (dir, h.bucket_cnt - 1, hi))
+		goto done;
+	for (i = buckets; i < h.bucket_cnt - 1; i++)
+		if (!write_bucket (dir, i, hi))
+			goto done;
+
+	for (i = 0; i < buckets; i++) {
+		if (!read_bucket (dir, i, lo))
+			goto done;
+		memset (hi, 0, sizeof *hi);
+		for (j = k = 0; j < BUCKET_ENTRIES; j++)
+			if (lo->entries[j].in_use
+					&& (hash_string (lo->entries[j].name) & buckets) != 0) {
+				hi->entries[k++] = lo->entries[j];
+				lo->entries[j].in_use = false;
+			}
+		if (k > 0
+				&& (!write_bucket (dir, i + buckets, hi)
+					|| !write_bucket (dir, i, lo)))
+			goto done;
+	}
+	success = inode_write_at (dir->inode, &h, sizeof h, 0) == sizeof h;
+
+done:
+	free (hi);
+	free (lo);
+	return success;
+}
+
 /* Adds a file named NAME to DIR, which must not already contain a
  * file by that name.  The file's inode is in sector
  * INODE_SECTOR.
@@ -126,6 +340,7 @@ dir_lookup (const struct dir *dir, const char *name,
 bool
 dir_add (struct dir *dir, const char *name, disk_sector_t inode_sector) {
 	struct dir_entry e;
+	size_t buckets;
 	off_t ofs;
 	bool success = false;
 
@@ -137,28 +352,68 @@ dir_add (struct dir *dir, const char *name, disk_sector_t inode_sector) {
 		return false;
 
 	/* Check that NAME is not in use. */
+	inode_lock_dir (dir->inode);
 	if (lookup (dir, name, NULL, NULL))
 		goto done;
 
-	/* Set OFS to offset of free slot.
-	 * If there are no free slots, then it will be set to the
-	 * current end-of-file.
-
-	 * inode_read_at() will only return a short read at end of file.
-	 * Otherwise, we'd need to verify that we didn't get a short
-	 * read due to something intermittent such as low memory. */
-	for (ofs = 0; inode_read_at (dir->inode, &e, sizeof e, ofs) == sizeof e;
-			ofs += sizeof e)
-		if (!e.in_use)
-			break;
-
-	/* Write slot. */
 	e.in_use = true;
 	strlcpy (e.name, name, sizeof e.name);
 	e.inode_sector = inode_sector;
-	success = inode_write_at (dir->inode, &e, sizeof e, ofs) == sizeof e;
+
+	buckets = bucket_cnt (dir);
+	if (buckets == 0) {
+		struct dir_entry slot;
+		size_t cnt = 0;
+
+		/* Set OFS to offset of free slot.
+		 * If there are no free slots, then it will be set to the
+		 * current end-of-file.
+
+		 * inode_read_at() will only return a short read at end of file.
+		 * Otherwise, we'd need to verify that we didn't get a short
+		 * read due to something intermittent such as low memory. */
+		for (ofs = LINEAR_OFS (0);
+				inode_read_at (dir->inode, &slot, sizeof slot, ofs) == sizeof slot;
+				ofs += sizeof slot, cnt++)
+			if (!slot.in_use)
+				break;
+
+		if (cnt < DIR_LINEAR_MAX) {
+			/* Write slot. */
+			success = inode_write_at (dir->inode, &e, sizeof e, ofs) == sizeof e;
+			goto done;
+		}
+
+		/* Full: switch to buckets. */
+		if (!hash_linear (dir, cnt))
+			goto done;
+		buckets = bucket_cnt (dir);
+	}
+
+	for (;;) {
+		size_t idx = hash_string (name) & (buckets - 1);
+		struct dir_bucket b;
+		size_t i;
+
+		if (!read_bucket (dir, idx, &b))
+			goto done;
+		for (i = 0; i < BUCKET_ENTRIES; i++)
+			if (!b.entries[i].in_use) {
+				success = inode_write_at (dir->inode, &e, sizeof e,
+						ENTRY_OFS (idx, i)) == sizeof e;
+				goto done;
+			}
+
+		/* NAME's bucket is full. */
+		if (!split_buckets (dir, buckets))
+			goto done;
+		buckets *= 2;
+	}
 
 done:
+	if (success)
+		dcache_insert (inode_get_inumber (dir->inode), name, inode_sector);
+	inode_unlock_dir (dir->inode);
 	return success;
 }
 
@@ -176,6 +431,7 @@ dir_remove (struct dir *dir, const char *name) {
 	ASSERT (name != NULL);
 
 	/* Find directory entry. */
+	inode_lock_dir (dir->inode);
 	if (!lookup (dir, name, &e, &ofs))
 		goto done;
 
@@ -189,11 +445,15 @@ dir_remove (struct dir *dir, const char *name) {
 	if (inode_write_at (dir->inode, &e, sizeof e, ofs) != sizeof e)
 		goto done;
 
-	/* Remove inode. */
+	/* Remove inode, and forget it in the dentry cache: the name is
+	 * gone, and so, if it was a directory, are the names in it. */
 	inode_remove (inode);
+	dcache_insert (inode_get_inumber (dir->inode), name, DCACHE_NEGATIVE);
+	dcache_invalidate_dir (e.inode_sector);
 	success = true;
 
 done:
+	inode_unlock_dir (dir->inode);
 	inode_close (inode);
 	return success;
 }
@@ -203,14 +463,34 @@ done:
  * contains no more entries. */
 bool
 dir_readdir (struct dir *dir, char name[NAME_MAX + 1]) {
+	size_t buckets;
 	struct dir_entry e;
-
-	while (inode_read_at (dir->inode, &e, sizeof e, dir->pos) == sizeof e) {
-		dir->pos += sizeof e;
-		if (e.in_use) {
-			strlcpy (name, e.name, NAME_MAX + 1);
-			return true;
+	bool found = false;
+
+	inode_lock_dir (dir->inode);
+	buckets = bucket_cnt (dir);
+	if (buckets != 0) {
+		struct dir_bucket b;
+		size_t idx;
+
+		/* Walk the buckets in order, reading each just once. */
+		while (!found && (idx = dir->pos / BUCKET_ENTRIES) < buckets
+				&& read_bucket (dir, idx, &b))
+			do {
+				e = b.entries[dir->pos++ % BUCKET_ENTRIES];
+				found = e.in_use;
+			} while (!found && dir->pos % BUCKET_ENTRIES != 0);
+	} else {
+		while (!found
+				&& inode_read_at (dir->inode, &e, sizeof e, LINEAR_OFS (dir->pos))
+				== sizeof e) {
+			dir->pos++;
+			found = e.in_use;
 		}
 	}
-	return false;
+	inode_unlock_dir (dir->inode);
+
+	if (found)
+		strlcpy (name, e.name, NAME_MAX + 1);
+	return found;
 }
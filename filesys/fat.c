@@ -22,7 +22,8 @@ struct fat_fs {
 	unsigned int *fat;
 	unsigned int fat_length;
 	disk_sector_t data_start;
-	cluster_t last_clst;
+	cluster_t last_clst;        /* Last cluster allocated; see fat_alloc(). */
+	unsigned int free_cnt;      /* Free clusters. */
 	struct lock write_lock;
 };
 
@@ -30,6 +31,7 @@ static struct fat_fs *fat_fs;
 
 void fat_boot_create (void);
 void fat_fs_init (void);
+static void fat_count_free (void);
 
 void
 fat_init (void) {
@@ -78,6 +80,7 @@ fat_open (void) {
 			free (bounce);
 		}
 	}
+	fat_count_free ();
 }
 
 void
@@ -123,6 +126,7 @@ fat_create (void) {
 	fat_fs->fat = calloc (fat_fs->fat_length, sizeof (cluster_t));
 	if (fat_fs->fat == NULL)
 		PANIC ("FAT creation failed");
+	fat_count_free ();
 
 	// Set up ROOT_DIR_CLST
 	fat_put (ROOT_DIR_CLUSTER, EOChain);
@@ -150,9 +154,62 @@ fat_boot_create (void) {
 	};
 }
 
+/* Sets up the in-memory FAT geometry from the boot sector.  Cluster
+ * 0 stands for "no cluster", so clusters are numbered from 1, and
+ * cluster C lives in the C'th sector after the FAT. */
 void
 fat_fs_init (void) {
-	/* TODO: Your code goes here. */
+	unsigned int data_sectors;
+
+	fat_fs->data_start = fat_fs->bs.fat_start + fat_fs->bs.fat_sectors;
+	data_sectors = (fat_fs->bs.total_sectors - fat_fs->data_start)
+		/ SECTORS_PER_CLUSTER;
+	fat_fs->fat_length = fat_fs->bs.fat_sectors
+		* (DISK_SECTOR_SIZE / sizeof (cluster_t));
+	if (fat_fs->fat_length > data_sectors + 1)
+		fat_fs->fat_length = data_sectors + 1;
+	fat_fs->last_clst = ROOT_DIR_CLUSTER;
+	fat_fs->free_cnt = 0;
+	lock_init (&fat_fs->write_lock);
+}
+
+/* Counts the free clusters once, when the FAT is loaded, so that
+ * allocation never has to scan for them. */
+static void
+fat_count_free (void) {
+	cluster_t clst;
+
+	fat_fs->free_cnt = 0;
+	for (clst = 1; clst < fat_fs->fat_length; clst++)
+		if (fat_fs->fat[clst] == 0)
+			fat_fs->free_cnt++;
+}
+
+/* Returns a free cluster, or 0 if there is none.  Next-fit: the
+ * cluster right after HINT is preferred, so that clusters allocated
+ * one at a time in order stay contiguous on disk.  Otherwise the
+ * search resumes where the last one left off instead of at the start
+ * of the FAT.
+ * Must be called with the write lock held. */
+static cluster_t
+fat_alloc (cluster_t hint) {
+	cluster_t clst;
+	unsigned int i;
+
+	if (fat_fs->free_cnt == 0)
+		return 0;
+	if (hint != 0 && hint + 1 < fat_fs->fat_length
+			&& fat_fs->fat[hint + 1] == 0)
+		return fat_fs->last_clst = hint + 1;
+
+	clst = fat_fs->last_clst;
+	for (i = 1; i < fat_fs->fat_length; i++) {
+		if (++clst >= fat_fs->fat_length)
+			clst = 1;
+		if (fat_fs->fat[clst] == 0)
+			return fat_fs->last_clst = clst;
+	}
+	NOT_REACHED ();
 }
 
 /*----------------------------------------------------------------------------*/
@@ -164,30 +221,85 @@ fat_fs_init (void) {
  * Returns 0 if fails to allocate a new cluster. */
 cluster_t
 fat_create_chain (cluster_t clst) {
-	/* TODO: Your code goes here. */
+	cluster_t new_clst;
+
+	lock_acquire (&fat_fs->write_lock);
+	new_clst = fat_alloc (clst);
+	if (new_clst != 0) {
+		if (clst != 0) {
+			fat_put (new_clst, fat_get (clst));
+			fat_put (clst, new_clst);
+		} else
+			fat_put (new_clst, EOChain);
+	}
+	lock_release (&fat_fs->write_lock);
+	return new_clst;
+}
+
+/* Starts a new chain of one cluster, preferably the one right after
+ * HINT, or anywhere if HINT is 0.
+ * Returns 0 if fails to allocate a new cluster. */
+cluster_t
+fat_create_chain_after (cluster_t hint) {
+	cluster_t new_clst;
+
+	lock_acquire (&fat_fs->write_lock);
+	new_clst = fat_alloc (hint);
+	if (new_clst != 0)
+		fat_put (new_clst, EOChain);
+	lock_release (&fat_fs->write_lock);
+	return new_clst;
 }
 
 /* Remove the chain of clusters starting from CLST.
  * If PCLST is 0, assume CLST as the start of the chain. */
 void
 fat_remove_chain (cluster_t clst, cluster_t pclst) {
-	/* TODO: Your code goes here. */
+	lock_acquire (&fat_fs->write_lock);
+	if (pclst != 0) {
+		ASSERT (fat_get (pclst) == clst);
+		fat_put (pclst, EOChain);
+	}
+	while (clst != EOChain) {
+		cluster_t next = fat_get (clst);
+
+		fat_put (clst, 0);
+		clst = next;
+	}
+	lock_release (&fat_fs->write_lock);
 }
 
 /* Update a value in the FAT table. */
 void
 fat_put (cluster_t clst, cluster_t val) {
-	/* TODO: Your code goes here. */
+	cluster_t old;
+
+	ASSERT (clst >= 1 && clst < fat_fs->fat_length);
+	old = fat_fs->fat[clst];
+	if (old == 0 && val != 0)
+		fat_fs->free_cnt--;
+	else if (old != 0 && val == 0)
+		fat_fs->free_cnt++;
+	fat_fs->fat[clst] = val;
 }
 
 /* Fetch a value in the FAT table. */
 cluster_t
 fat_get (cluster_t clst) {
-	/* TODO: Your code goes here. */
+	ASSERT (clst >= 1 && clst < fat_fs->fat_length);
+	return fat_fs->fat[clst];
 }
 
 /* Covert a cluster # to a sector number. */
 disk_sector_t
 cluster_to_sector (cluster_t clst) {
-	/* TODO: Your code goes here. */
+	ASSERT (clst >= 1 && clst < fat_fs->fat_length);
+	return fat_fs->data_start + (clst - 1) * SECTORS_PER_CLUSTER;
+}
+
+/* Converts SECTOR, the first sector of a cluster, to the cluster. */
+cluster_t
+sector_to_cluster (disk_sector_t sector) {
+	ASSERT (sector >= fat_fs->data_start);
+	return (sector - fat_fs->data_start) / SECTORS_PER_CLUSTER + 1;
 }
@@ -4,9 +4,14 @@
 #include "filesys/file.h"
 #include "filesys/filesys.h"
 #include "filesys/inode.h"
+#include "threads/synch.h"
+#ifdef EFILESYS
+#include "filesys/fat.h"
+#endif
 
 static struct file *free_map_file;   /* Free map file. */
 static struct bitmap *free_map;      /* Free map, one bit per disk sector. */
+static struct lock free_map_lock;    /* Protects FREE_MAP and its file. */
 
 /* Initializes the free map. */
 void
@@ -16,6 +21,7 @@ free_map_init (void) {
 		PANIC ("bitmap creation failed--disk is too large");
 	bitmap_mark (free_map, FREE_MAP_SECTOR);
 	bitmap_mark (free_map, ROOT_DIR_SECTOR);
+	lock_init (&free_map_lock);
 }
 
 /* Allocates CNT consecutive sectors from the free map and stores
@@ -24,24 +30,121 @@ free_map_init (void) {
  * available. */
 bool
 free_map_allocate (size_t cnt, disk_sector_t *sectorp) {
-	disk_sector_t sector = bitmap_scan_and_flip (free_map, 0, cnt, false);
+#ifdef EFILESYS
+	size_t n = free_map_allocate_run (cnt, 0, sectorp);
+
+	if (n > 0 && n < cnt)
+		free_map_release (*sectorp, n);
+	return n == cnt;
+#else
+	disk_sector_t sector;
+
+	lock_acquire (&free_map_lock);
+	sector = bitmap_scan_and_flip (free_map, 0, cnt, false);
 	if (sector != BITMAP_ERROR
 			&& free_map_file != NULL
 			&& !bitmap_write (free_map, free_map_file)) {
 		bitmap_set_multiple (free_map, sector, cnt, false);
 		sector = BITMAP_ERROR;
 	}
+	lock_release (&free_map_lock);
 	if (sector != BITMAP_ERROR)
 		*sectorp = sector;
 	return sector != BITMAP_ERROR;
+#endif
+}
+
+#ifdef EFILESYS
+/* Allocates a run of at most CNT consecutive sectors and stores the
+ * first into *SECTORP.  The run starts at HINT if that sector is free,
+ * so that a file growing at its end stays contiguous; otherwise where
+ * the FAT's next-fit search lands.
+ * Returns the number of sectors allocated, 0 if the disk is full. */
+size_t
+free_map_allocate_run (size_t cnt, disk_sector_t hint,
+		disk_sector_t *sectorp) {
+	/* Sectors are clusters of the FAT.  Files index their sectors
+	 * themselves, so each cluster is a chain of its own, which marks it
+	 * in use. */
+	cluster_t prev = hint != 0 ? sector_to_cluster (hint) - 1 : 0;
+	cluster_t first = 0;
+	size_t n;
+
+	ASSERT (cnt > 0);
+	for (n = 0; n < cnt; n++) {
+		cluster_t clst = fat_create_chain_after (prev);
+
+		if (clst == 0)
+			break;
+		if (n > 0 && clst != prev + 1) {
+			fat_remove_chain (clst, 0);
+			break;
+		}
+		if (n == 0)
+			first = clst;
+		prev = clst;
+	}
+	if (n > 0)
+		*sectorp = cluster_to_sector (first);
+	return n;
 }
+#else
+/* Allocates a run of at most CNT consecutive sectors and stores the
+ * first into *SECTORP.  The run starts at HINT if that sector is free,
+ * so that a file growing at its end stays contiguous; otherwise it is
+ * the first run of CNT free sectors or, on a fragmented disk, the first
+ * free sector and as many free ones as follow it.
+ * Returns the number of sectors allocated, 0 if the disk is full. */
+size_t
+free_map_allocate_run (size_t cnt, disk_sector_t hint,
+		disk_sector_t *sectorp) {
+	size_t size = bitmap_size (free_map);
+	size_t start, n;
+
+	ASSERT (cnt > 0);
+	lock_acquire (&free_map_lock);
+	if (hint != 0 && hint < size && !bitmap_test (free_map, hint))
+		start = hint;
+	else {
+		start = bitmap_scan (free_map, 0, cnt, false);
+		if (start == BITMAP_ERROR)
+			start = bitmap_scan (free_map, 0, 1, false);
+		if (start == BITMAP_ERROR) {
+			lock_release (&free_map_lock);
+			return 0;
+		}
+	}
+	for (n = 0; n < cnt && start + n < size; n++)
+		if (bitmap_test (free_map, start + n))
+			break;
+
+	bitmap_set_multiple (free_map, start, n, true);
+	if (free_map_file != NULL && !bitmap_write (free_map, free_map_file)) {
+		bitmap_set_multiple (free_map, start, n, false);
+		n = 0;
+	}
+	lock_release (&free_map_lock);
+	*sectorp = start;
+	return n;
+}
+#endif
 
 /* Makes CNT sectors starting at SECTOR available for use. */
 void
 free_map_release (disk_sector_t sector, size_t cnt) {
+#ifdef EFILESYS
+	/* Each sector is a chain of its own (see above). */
+	size_t i;
+
+	for (i = 0; i < cnt; i++)
+		fat_remove_chain (sector_to_cluster (sector + i), 0);
+#else
+	lock_acquire (&free_map_lock);
 	ASSERT (bitmap_all (free_map, sector, cnt));
 	bitmap_set_multiple (free_map, sector, cnt, false);
 	bitmap_write (free_map, free_map_file);
+	lock_release (&free_map_lock);
+#endif
 }
 
 /* Opens the free map file and reads it from disk. */
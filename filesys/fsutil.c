@@ -1,5 +1,6 @@
 #include "filesys/fsutil.h"
 #include <debug.h>
+#include <round.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -7,10 +8,17 @@
 #include "filesys/file.h"
 #include "filesys/filesys.h"
 #include "devices/disk.h"
+#include "devices/timer.h"
 #include "threads/malloc.h"
 #include "threads/palloc.h"
 #include "threads/vaddr.h"
 
+/* Sectors that put copies from the scratch disk per request. */
+#define PUT_SECTORS 64
+
+/* Most sectors of each disk that bench-disk moves per pass. */
+#define BENCH_SECTORS 8192
+
 /* List files in the root directory. */
 void
 fsutil_ls (char **argv UNUSED) {
@@ -87,7 +95,7 @@ fsutil_put (char **argv) {
 	printf ("Putting '%s' into the file system...\n", file_name);
 
 	/* Allocate buffer. */
-	buffer = malloc (DISK_SECTOR_SIZE);
+	buffer = malloc (PUT_SECTORS * DISK_SECTOR_SIZE);
 	if (buffer == NULL)
 		PANIC ("couldn't allocate buffer");
 
@@ -111,10 +119,17 @@ fsutil_put (char **argv) {
 	if (dst == NULL)
 		PANIC ("%s: open failed", file_name);
 
-	/* Do copy. */
+	/* Do copy, up to PUT_SECTORS sectors at a time. */
 	while (size > 0) {
-		int chunk_size = size > DISK_SECTOR_SIZE ? DISK_SECTOR_SIZE : size;
-		disk_read (src, sector++, buffer);
+		size_t cnt = DIV_ROUND_UP (size, DISK_SECTOR_SIZE);
+		int chunk_size;
+
+		if (cnt > PUT_SECTORS)
+			cnt = PUT_SECTORS;
+		chunk_size = size < (off_t) (cnt * DISK_SECTOR_SIZE)
+			? size : (off_t) (cnt * DISK_SECTOR_SIZE);
+		disk_read_multi (src, sector, cnt, buffer);
+		sector += cnt;
 		if (file_write (dst, buffer, chunk_size) != chunk_size)
 			PANIC ("%s: write failed with %"PROTd" bytes unwritten",
 					file_name, size);
@@ -187,3 +202,66 @@ fsutil_get (char **argv) {
 	file_close (src);
 	free (buffer);
 }
+
+/* Moves the first sectors of disk D, up to BENCH_SECTORS, in
+ * requests of CNT sectors each through BUFFER, which holds
+ * DISK_MULTI_MAX sectors, and prints the read throughput.  If WRITE
+ * is true, writes each request's sectors back after reading them and
+ * prints the write throughput too. */
+static void
+bench_pass (struct disk *d, const char *name, size_t cnt, bool write,
+		void *buffer) {
+	disk_sector_t total = disk_size (d);
+	int64_t read_ticks = 0, write_ticks = 0;
+	disk_sector_t sector;
+
+	if (total > BENCH_SECTORS)
+		total = BENCH_SECTORS;
+	for (sector = 0; sector < total; sector += cnt) {
+		size_t n = total - sector < cnt ? total - sector : cnt;
+		int64_t start = timer_ticks ();
+
+		disk_read_multi (d, sector, n, buffer);
+		read_ticks += timer_elapsed (start);
+		if (write) {
+			start = timer_ticks ();
+			disk_write_multi (d, sector, n, buffer);
+			write_ticks += timer_elapsed (start);
+		}
+	}
+
+	printf ("%s disk, %3zu-sector requests: read %"PRDSNu" sectors "
+			"in %"PRId64" ticks (%"PRId64" kB/s)",
+			name, cnt, total, read_ticks,
+			total / 2 * TIMER_FREQ / (read_ticks > 0 ? read_ticks : 1));
+	if (write)
+		printf (", wrote them in %"PRId64" ticks (%"PRId64" kB/s)",
+				write_ticks,
+				total / 2 * TIMER_FREQ / (write_ticks > 0 ? write_ticks : 1));
+	printf ("\n");
+}
+
+/* Measures raw disk throughput with requests of 1 to DISK_MULTI_MAX
+ * sectors: reads on the file system disk, and reads and writes of
+ * the same data back on the swap disk, if there is one.  The 1-sector
+ * pass moves one sector per command, as every transfer did before
+ * multi-sector requests, so it is the baseline for the others.
+ * Leaves both disks' contents unchanged, but must run before anything
+ * uses the swap disk. */
+void
+fsutil_bench (char **argv UNUSED) {
+	static const size_t sizes[] = {1, 8, 64, DISK_MULTI_MAX};
+	size_t page_cnt = DISK_MULTI_MAX * DISK_SECTOR_SIZE / PGSIZE;
+	struct disk *swap = disk_get (1, 1);
+	void *buffer;
+	size_t i;
+
+	printf ("Measuring raw disk throughput...\n");
+	buffer = palloc_get_multiple (PAL_ASSERT, page_cnt);
+	for (i = 0; i < sizeof sizes / sizeof *sizes; i++) {
+		bench_pass (filesys_disk, "file system", sizes[i], false, buffer);
+		if (swap != NULL)
+			bench_pass (swap, "swap", sizes[i], true, buffer);
+	}
+	palloc_free_multiple (buffer, page_cnt);
+}
@@ -1,22 +1,73 @@
 #include "filesys/inode.h"
+#include <hash.h>
 #include <list.h>
 #include <debug.h>
 #include <round.h>
 #include <string.h>
 #include "filesys/filesys.h"
 #include "filesys/free-map.h"
+#include "filesys/page_cache.h"
 #include "threads/malloc.h"
+#include "threads/synch.h"
 
 /* Identifies an inode. */
 #define INODE_MAGIC 0x494e4f44
 
+/* Fewest whole sectors, consecutive on disk, that a read or write
+ * moves with one direct disk request instead of through the cache. */
+#define DIRECT_MIN 8
+
+#ifdef EFILESYS
+/* Sector pointers in the inode and in each index block.  A pointer
+ * of 0 is a hole, which reads as zeros and has no sector. */
+#define DIRECT_CNT 123
+#define PTRS_PER_BLOCK (DISK_SECTOR_SIZE / sizeof (disk_sector_t))
+
+/* Largest file: direct, indirect, doubly and triply indirect sectors,
+ * a little over 1 GiB. */
+#define INODE_MAX_SECTORS \
+	(DIRECT_CNT + PTRS_PER_BLOCK + PTRS_PER_BLOCK * PTRS_PER_BLOCK \
+	 + PTRS_PER_BLOCK * PTRS_PER_BLOCK * PTRS_PER_BLOCK)
+#define INODE_MAX_LENGTH ((off_t) (INODE_MAX_SECTORS * DISK_SECTOR_SIZE))
+#endif
+
+#ifndef EFILESYS
+/* A run of data sectors that are consecutive on disk.  END is the
+ * number of file sectors up to the end of the run, so that the
+ * extents of a file are sorted by it. */
+struct extent {
+	disk_sector_t start;                /* First sector. */
+	uint32_t end;                       /* File sectors through this run. */
+};
+
+/* Extents held by the inode itself and by each overflow block. */
+#define INODE_EXTENTS 62
+#define BLOCK_EXTENTS 63
+
+/* Overflow block: extents past the first INODE_EXTENTS.
+ * Must be exactly DISK_SECTOR_SIZE bytes long. */
+struct extent_block {
+	disk_sector_t next;                 /* Next overflow block, or 0. */
+	uint32_t unused;                    /* Not used. */
+	struct extent extents[BLOCK_EXTENTS];
+};
+#endif
+
 /* On-disk inode.
  * Must be exactly DISK_SECTOR_SIZE bytes long. */
 struct inode_disk {
-	disk_sector_t start;                /* First data sector. */
 	off_t length;                       /* File size in bytes. */
 	unsigned magic;                     /* Magic number. */
-	uint32_t unused[125];               /* Not used. */
+#ifdef EFILESYS
+	disk_sector_t direct[DIRECT_CNT];   /* Direct data sectors. */
+	disk_sector_t indirect;             /* Indirect block. */
+	disk_sector_t doubly_indirect;      /* Doubly indirect block. */
+	disk_sector_t triply_indirect;      /* Triply indirect block. */
+#else
+	uint32_t extent_cnt;                /* Number of extents. */
+	disk_sector_t overflow;             /* First overflow block, or 0. */
+	struct extent extents[INODE_EXTENTS];   /* First extents. */
+#endif
 };
 
 /* Returns the number of sectors to allocate for an inode SIZE
@@ -28,35 +79,596 @@ bytes_to_sectors (off_t size) {
 
 /* In-memory inode. */
 struct inode {
-	struct list_elem elem;              /* Element in inode list. */
+	struct hash_elem elem;              /* Element in inode table. */
+	struct list_elem lru_elem;          /* In CLOSED_INODES, if closed. */
 	disk_sector_t sector;               /* Sector number of disk location. */
 	int open_cnt;                       /* Number of openers. */
 	bool removed;                       /* True if deleted, false otherwise. */
 	int deny_write_cnt;                 /* 0: writes ok, >0: deny writes. */
 	struct inode_disk data;             /* Inode content. */
+	struct rwlock rwlock;               /* Shared by reads and writes within
+	                                       the file, exclusive to growth. */
+	struct lock dir_lock;               /* Held by directory operations. */
+#ifdef EFILESYS
+	struct lock index_lock;             /* Guards the index blocks. */
+	disk_sector_t alloc_hint;           /* Sector to allocate next if free. */
+	disk_sector_t *indirect;            /* Cached index blocks, or null. */
+	disk_sector_t *doubly_indirect;
+	disk_sector_t **indirects;          /* ...below the doubly indirect. */
+	disk_sector_t *triply_indirect;
+	disk_sector_t **doublies;           /* ...below the triply indirect, */
+	disk_sector_t ***triply_indirects;  /* ...and below those. */
+#else
+	struct extent_block **blocks;       /* Overflow blocks, in order. */
+#endif
 };
 
+#ifdef EFILESYS
+/* Writes *SLOT, which lies in the index block at BASE that is cached
+ * from SECTOR, through to the disk after setting it to VALUE. */
+static void
+set_slot (disk_sector_t sector, void *base, disk_sector_t *slot,
+		disk_sector_t value) {
+	*slot = value;
+	page_cache_write (sector, slot, (uint8_t *) slot - (uint8_t *) base,
+			sizeof *slot);
+}
+
+/* Allocates a sector for INODE, zeroes it if ZERO and stores it into
+ * *SECTORP.  The sector after the one INODE got last is preferred, so
+ * that a file written in order is laid out in order.
+ * Must be called with INODE's index lock held. */
+static bool
+alloc_sector (struct inode *inode, disk_sector_t *sectorp, bool zero) {
+	static char zeros[DISK_SECTOR_SIZE];
+
+	if (free_map_allocate_run (1, inode->alloc_hint, sectorp) == 0)
+		return false;
+	inode->alloc_hint = *sectorp + 1;
+	if (zero)
+		page_cache_write (*sectorp, zeros, 0, DISK_SECTOR_SIZE);
+	return true;
+}
+
+/* Returns the index block of INODE that *SLOT points to, which is
+ * kept in *CACHE once read, so that later lookups through it need no
+ * disk or cache access.  *SLOT lies in the block at BASE, cached from
+ * PARENT.  An empty slot gets a new zeroed block if CREATE, and
+ * otherwise yields a null pointer, as does a shortage of memory or
+ * disk. */
+static disk_sector_t *
+get_index (struct inode *inode, disk_sector_t **cache, disk_sector_t parent,
+		void *base, disk_sector_t *slot, bool create) {
+	if (*slot == 0 && !create)
+		return NULL;
+	if (*cache == NULL) {
+		*cache = malloc (DISK_SECTOR_SIZE);
+		if (*cache == NULL)
+			return NULL;
+		if (*slot != 0)
+			page_cache_read (*slot, *cache, 0, DISK_SECTOR_SIZE);
+		else
+			memset (*cache, 0, DISK_SECTOR_SIZE);
+	}
+	if (*slot == 0) {
+		disk_sector_t sector;
+
+		if (!alloc_sector (inode, &sector, true))
+			return NULL;
+		set_slot (parent, base, slot, sector);
+	}
+	return *cache;
+}
+
+/* Returns the array *CACHES of the cached index blocks below one index
+ * block, allocating it when first needed, or a null pointer if memory
+ * is short. */
+static disk_sector_t **
+get_caches (disk_sector_t ***caches) {
+	if (*caches == NULL)
+		*caches = calloc (PTRS_PER_BLOCK, sizeof **caches);
+	return *caches;
+}
+
+/* Returns the sector that holds file sector IDX of INODE, or 0 if it
+ * is a hole.  If CREATE, fills a hole with a new sector first, zeroed
+ * if ZERO, and returns 0 only if memory or disk is short. */
+static disk_sector_t
+inode_block (struct inode *inode, size_t idx, bool create, bool zero) {
+	struct inode_disk *disk_inode = &inode->data;
+	disk_sector_t parent = inode->sector;
+	void *base = disk_inode;
+	disk_sector_t *slot;
+
+	ASSERT (idx < INODE_MAX_SECTORS);
+	if (idx < DIRECT_CNT)
+		slot = &disk_inode->direct[idx];
+	else if ((idx -= DIRECT_CNT) < PTRS_PER_BLOCK) {
+		disk_sector_t *block = get_index (inode, &inode->indirect, parent,
+				base, &disk_inode->indirect, create);
+
+		if (block == NULL)
+			return 0;
+		parent = disk_inode->indirect;
+		base = block;
+		slot = &block[idx];
+	} else if ((idx -= PTRS_PER_BLOCK) < PTRS_PER_BLOCK * PTRS_PER_BLOCK) {
+		disk_sector_t *top, *block, **caches;
+
+		top = get_index (inode, &inode->doubly_indirect, parent, base,
+				&disk_inode->doubly_indirect, create);
+		if (top == NULL || (caches = get_caches (&inode->indirects)) == NULL)
+			return 0;
+		block = get_index (inode, &caches[idx / PTRS_PER_BLOCK],
+				disk_inode->doubly_indirect, top, &top[idx / PTRS_PER_BLOCK],
+				create);
+		if (block == NULL)
+			return 0;
+		parent = top[idx / PTRS_PER_BLOCK];
+		base = block;
+		slot = &block[idx % PTRS_PER_BLOCK];
+	} else {
+		size_t hi, mid;
+		disk_sector_t *top, *middle, *block, **caches;
+
+		idx -= PTRS_PER_BLOCK * PTRS_PER_BLOCK;
+		hi = idx / (PTRS_PER_BLOCK * PTRS_PER_BLOCK);
+		mid = idx / PTRS_PER_BLOCK % PTRS_PER_BLOCK;
+		top = get_index (inode, &inode->triply_indirect, parent, base,
+				&disk_inode->triply_indirect, create);
+		if (top == NULL || (caches = get_caches (&inode->doublies)) == NULL)
+			return 0;
+		middle = get_index (inode, &caches[hi], disk_inode->triply_indirect,
+				top, &top[hi], create);
+		if (middle == NULL)
+			return 0;
+		if (inode->triply_indirects == NULL) {
+			inode->triply_indirects = calloc (PTRS_PER_BLOCK,
+					sizeof *inode->triply_indirects);
+			if (inode->triply_indirects == NULL)
+				return 0;
+		}
+		caches = get_caches (&inode->triply_indirects[hi]);
+		if (caches == NULL)
+			return 0;
+		block = get_index (inode, &caches[mid], top[hi], middle, &middle[mid],
+				create);
+		if (block == NULL)
+			return 0;
+		parent = middle[mid];
+		base = block;
+		slot = &block[idx % PTRS_PER_BLOCK];
+	}
+
+	if (*slot == 0 && create) {
+		disk_sector_t sector;
+
+		if (alloc_sector (inode, &sector, zero))
+			set_slot (parent, base, slot, sector);
+	}
+	return *slot;
+}
+
+/* Returns the disk sector that contains byte offset POS within
+ * INODE, or 0 if that byte lies in a hole.
+ * Returns -1 if INODE does not contain data for a byte at offset
+ * POS. */
+static disk_sector_t
+byte_to_sector (struct inode *inode, off_t pos) {
+	ASSERT (inode != NULL);
+	if (pos < inode->data.length) {
+		disk_sector_t sector;
+
+		lock_acquire (&inode->index_lock);
+		sector = inode_block (inode, pos / DISK_SECTOR_SIZE, false, false);
+		lock_release (&inode->index_lock);
+		return sector;
+	} else
+		return -1;
+}
+
+/* Extends INODE to LENGTH bytes and writes the inode to disk.  The
+ * new bytes are a hole: sectors are allocated only when written. */
+static bool
+inode_grow (struct inode *inode, off_t length) {
+	if (length > INODE_MAX_LENGTH)
+		return false;
+	inode->data.length = length;
+	page_cache_write (inode->sector, &inode->data, 0, DISK_SECTOR_SIZE);
+	return true;
+}
+
+/* Readies INODE for a write of SIZE bytes at OFFSET by filling the
+ * holes in that range and extending the inode to cover it.  Returns
+ * the number of bytes from OFFSET on that may be written, less than
+ * SIZE if the disk fills up or the file would grow too large.
+ * New sectors are zeroed, except those the write covers completely if
+ * EXCL says that the caller keeps readers out: nobody can then read
+ * them before the write fills them. */
+static off_t
+inode_reserve (struct inode *inode, off_t offset, off_t size, bool excl) {
+	off_t end;
+	size_t idx;
+
+	if (size <= 0 || offset >= INODE_MAX_LENGTH)
+		return 0;
+	if (size > INODE_MAX_LENGTH - offset)
+		size = INODE_MAX_LENGTH - offset;
+	end = offset + size;
+	lock_acquire (&inode->index_lock);
+	for (idx = offset / DISK_SECTOR_SIZE;
+			(off_t) idx * DISK_SECTOR_SIZE < end; idx++) {
+		bool zero = !excl || (off_t) idx * DISK_SECTOR_SIZE < offset
+			|| (off_t) (idx + 1) * DISK_SECTOR_SIZE > end;
+
+		if (inode_block (inode, idx, true, zero) == 0) {
+			end = (off_t) idx * DISK_SECTOR_SIZE;
+			if (end < offset)
+				end = offset;
+			break;
+		}
+	}
+	lock_release (&inode->index_lock);
+	if (end > inode->data.length)
+		inode_grow (inode, end);
+	return end - offset;
+}
+
+/* Frees the sector SECTOR and, if it is an index block LEVEL levels
+ * above the data, every sector it points to. */
+static void
+release_block (disk_sector_t sector, int level) {
+	if (sector == 0)
+		return;
+	if (level > 0) {
+		disk_sector_t *block = malloc (DISK_SECTOR_SIZE);
+		size_t i;
+
+		if (block != NULL) {
+			page_cache_read (sector, block, 0, DISK_SECTOR_SIZE);
+			for (i = 0; i < PTRS_PER_BLOCK; i++)
+				release_block (block[i], level - 1);
+			free (block);
+		}
+	}
+	free_map_release (sector, 1);
+}
+
+/* Frees the data sectors and index blocks of INODE. */
+static void
+inode_release (struct inode *inode) {
+	size_t i;
+
+	for (i = 0; i < DIRECT_CNT; i++)
+		release_block (inode->data.direct[i], 0);
+	release_block (inode->data.indirect, 1);
+	release_block (inode->data.doubly_indirect, 2);
+	release_block (inode->data.triply_indirect, 3);
+}
+
+/* Readies the in-memory parts of INODE, just read from disk.  Index
+ * blocks are read when first needed. */
+static bool
+inode_load (struct inode *inode) {
+	lock_init (&inode->index_lock);
+	inode->alloc_hint = inode->sector + 1;
+	inode->indirect = NULL;
+	inode->doubly_indirect = NULL;
+	inode->indirects = NULL;
+	inode->triply_indirect = NULL;
+	inode->doublies = NULL;
+	inode->triply_indirects = NULL;
+	return true;
+}
+
+/* Frees the array CACHES of cached index blocks and the blocks. */
+static void
+free_caches (disk_sector_t **caches) {
+	size_t i;
+
+	if (caches != NULL) {
+		for (i = 0; i < PTRS_PER_BLOCK; i++)
+			free (caches[i]);
+		free (caches);
+	}
+}
+
+/* Frees INODE and the memory it holds. */
+static void
+inode_free (struct inode *inode) {
+	size_t i;
+
+	if (inode->triply_indirects != NULL) {
+		for (i = 0; i < PTRS_PER_BLOCK; i++)
+			free_caches (inode->triply_indirects[i]);
+		free (inode->triply_indirects);
+	}
+	free_caches (inode->doublies);
+	free_caches (inode->indirects);
+	free (inode->triply_indirect);
+	free (inode->indirect);
+	free (inode->doubly_indirect);
+	free (inode);
+}
+#else
+/* Returns the number of overflow blocks that INODE's extents take. */
+static size_t
+block_cnt (const struct inode *inode) {
+	size_t cnt = inode->data.extent_cnt;
+
+	return cnt > INODE_EXTENTS
+		? DIV_ROUND_UP (cnt - INODE_EXTENTS, BLOCK_EXTENTS) : 0;
+}
+
+/* Returns the sector of INODE's overflow block IDX. */
+static disk_sector_t
+block_sector (const struct inode *inode, size_t idx) {
+	return idx == 0 ? inode->data.overflow : inode->blocks[idx - 1]->next;
+}
+
+/* Returns INODE's extent IDX. */
+static struct extent *
+extent_at (struct inode *inode, size_t idx) {
+	if (idx < INODE_EXTENTS)
+		return &inode->data.extents[idx];
+	idx -= INODE_EXTENTS;
+	return &inode->blocks[idx / BLOCK_EXTENTS]->extents[idx % BLOCK_EXTENTS];
+}
+
+/* Returns the number of file sectors before INODE's extent IDX. */
+static size_t
+extent_begin (struct inode *inode, size_t idx) {
+	return idx > 0 ? extent_at (inode, idx - 1)->end : 0;
+}
+
+/* Returns the disk sector that holds file sector IDX of INODE, which
+ * must be allocated. */
+static disk_sector_t
+extent_sector (struct inode *inode, size_t idx) {
+	/* Binary search for the first extent that ends past the sector. */
+	size_t lo = 0, hi = inode->data.extent_cnt - 1;
+
+	while (lo < hi) {
+		size_t mid = lo + (hi - lo) / 2;
+
+		if (extent_at (inode, mid)->end <= idx)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return extent_at (inode, lo)->start + (idx - extent_begin (inode, lo));
+}
+
 /* Returns the disk sector that contains byte offset POS within
  * INODE.
  * Returns -1 if INODE does not contain data for a byte at offset
  * POS. */
 static disk_sector_t
-byte_to_sector (const struct inode *inode, off_t pos) {
+byte_to_sector (struct inode *inode, off_t pos) {
 	ASSERT (inode != NULL);
 	if (pos < inode->data.length)
-		return inode->data.start + pos / DISK_SECTOR_SIZE;
+		return extent_sector (inode, pos / DISK_SECTOR_SIZE);
 	else
 		return -1;
 }
 
-/* List of open inodes, so that opening a single inode twice
- * returns the same `struct inode'. */
-static struct list open_inodes;
+/* Returns true if file sector IDX lies wholly within bytes SKIP_OFS
+ * up to SKIP_END. */
+static bool
+sector_covered (size_t idx, off_t skip_ofs, off_t skip_end) {
+	return (off_t) idx * DISK_SECTOR_SIZE >= skip_ofs
+		&& (off_t) (idx + 1) * DISK_SECTOR_SIZE <= skip_end;
+}
+
+/* Appends an empty extent to INODE, chaining on a new overflow block
+ * if the last one is full.  Returns false if memory or disk
+ * allocation fails. */
+static bool
+inode_add_extent (struct inode *inode) {
+	size_t cnt = inode->data.extent_cnt;
+
+	if (cnt >= INODE_EXTENTS && (cnt - INODE_EXTENTS) % BLOCK_EXTENTS == 0) {
+		size_t idx = (cnt - INODE_EXTENTS) / BLOCK_EXTENTS;
+		struct extent_block **blocks;
+		disk_sector_t sector;
+
+		blocks = realloc (inode->blocks, (idx + 1) * sizeof *blocks);
+		if (blocks == NULL)
+			return false;
+		inode->blocks = blocks;
+		blocks[idx] = calloc (1, sizeof *blocks[idx]);
+		if (blocks[idx] == NULL)
+			return false;
+		if (!free_map_allocate (1, &sector)) {
+			free (blocks[idx]);
+			return false;
+		}
+		if (idx == 0)
+			inode->data.overflow = sector;
+		else
+			blocks[idx - 1]->next = sector;
+	}
+	inode->data.extent_cnt++;
+	return true;
+}
+
+/* Extends INODE to LENGTH bytes and writes the inode to disk.  New
+ * sectors are zeroed, except those wholly within bytes SKIP_OFS up to
+ * SKIP_END, which the caller is about to write.  The last extent is
+ * lengthened in place if the sectors after it are free, and a new
+ * extent is started otherwise.
+ * Returns false if memory or disk allocation fails, leaving the
+ * length as it was.  Sectors allocated by then stay with the inode,
+ * past its end and zeroed, for the next extension to use. */
+static bool
+grow_extents (struct inode *inode, off_t length,
+		off_t skip_ofs, off_t skip_end) {
+	static char zeros[DISK_SECTOR_SIZE];
+	size_t cnt = inode->data.extent_cnt;
+	size_t have = cnt > 0 ? extent_at (inode, cnt - 1)->end : 0;
+	size_t first = have;
+	size_t need = bytes_to_sectors (length);
+	size_t dirty = cnt > 0 ? cnt - 1 : 0;
+	bool success = true;
+	size_t i;
+
+	while (have < need) {
+		disk_sector_t hint = 0, start;
+		size_t n;
+
+		cnt = inode->data.extent_cnt;
+		if (cnt > 0)
+			hint = extent_at (inode, cnt - 1)->start
+				+ (have - extent_begin (inode, cnt - 1));
+		n = free_map_allocate_run (need - have, hint, &start);
+		if (n == 0) {
+			success = false;
+			break;
+		}
+		if (cnt == 0 || start != hint) {
+			if (!inode_add_extent (inode)) {
+				free_map_release (start, n);
+				success = false;
+				break;
+			}
+			extent_at (inode, cnt)->start = start;
+		}
+		for (i = 0; i < n; i++)
+			if (!sector_covered (have + i, skip_ofs, skip_end))
+				page_cache_write (start + i, zeros, 0, DISK_SECTOR_SIZE);
+		have += n;
+		extent_at (inode, inode->data.extent_cnt - 1)->end = have;
+	}
+
+	if (success)
+		inode->data.length = length;
+	else {
+		/* The write will not reach the sectors skipped above, so they
+		 * must be zeroed after all before a later extension exposes
+		 * them. */
+		for (i = first; i < have; i++)
+			if (sector_covered (i, skip_ofs, skip_end))
+				page_cache_write (extent_sector (inode, i), zeros, 0,
+						DISK_SECTOR_SIZE);
+	}
+	page_cache_write (inode->sector, &inode->data, 0, DISK_SECTOR_SIZE);
+	for (i = dirty < INODE_EXTENTS ? 0 : (dirty - INODE_EXTENTS) / BLOCK_EXTENTS;
+			i < block_cnt (inode); i++)
+		page_cache_write (block_sector (inode, i), inode->blocks[i], 0,
+				DISK_SECTOR_SIZE);
+	return success;
+}
+
+/* Extends INODE to LENGTH bytes, zeroing every new sector. */
+static bool
+inode_grow (struct inode *inode, off_t length) {
+	return grow_extents (inode, length, 0, 0);
+}
+
+/* Readies INODE for a write of SIZE bytes at OFFSET by extending it
+ * to cover them.  Returns the number of bytes from OFFSET on that may
+ * be written, less than SIZE if the disk fills up.  New sectors the
+ * write covers completely are left for it to fill if EXCL says that
+ * the caller keeps readers out, and zeroed otherwise. */
+static off_t
+inode_reserve (struct inode *inode, off_t offset, off_t size, bool excl) {
+	if (size <= 0)
+		return 0;
+	if (offset + size > inode->data.length)
+		grow_extents (inode, offset + size,
+				excl ? offset : 0, excl ? offset + size : 0);
+	if (offset >= inode->data.length)
+		return 0;
+	return size < inode->data.length - offset
+		? size : inode->data.length - offset;
+}
+
+/* Frees the data sectors and overflow blocks of INODE. */
+static void
+inode_release (struct inode *inode) {
+	size_t i;
+
+	for (i = 0; i < inode->data.extent_cnt; i++)
+		free_map_release (extent_at (inode, i)->start,
+				extent_at (inode, i)->end - extent_begin (inode, i));
+	for (i = 0; i < block_cnt (inode); i++)
+		free_map_release (block_sector (inode, i), 1);
+}
+
+/* Readies the in-memory parts of INODE, just read from disk, by
+ * reading its overflow blocks.  Returns false if memory is short. */
+static bool
+inode_load (struct inode *inode) {
+	size_t cnt = block_cnt (inode);
+	size_t i;
+
+	inode->blocks = NULL;
+	if (cnt == 0)
+		return true;
+	inode->blocks = calloc (cnt, sizeof *inode->blocks);
+	if (inode->blocks == NULL)
+		return false;
+	for (i = 0; i < cnt; i++) {
+		inode->blocks[i] = malloc (sizeof *inode->blocks[i]);
+		if (inode->blocks[i] == NULL)
+			return false;
+		page_cache_read (block_sector (inode, i), inode->blocks[i], 0,
+				DISK_SECTOR_SIZE);
+	}
+	return true;
+}
+
+/* Frees INODE and the memory it holds. */
+static void
+inode_free (struct inode *inode) {
+	size_t i;
+
+	if (inode->blocks != NULL) {
+		for (i = 0; i < block_cnt (inode); i++)
+			free (inode->blocks[i]);
+		free (inode->blocks);
+	}
+	free (inode);
+}
+#endif
+
+/* Open inodes, by sector, so that opening a single inode twice
+ * returns the same `struct inode'.  The table also holds up to
+ * INODE_CACHE_SIZE inodes that are no longer open, so that opening
+ * a recently closed file again needs no read of its inode. */
+static struct hash open_inodes;
+
+/* Closed inodes still in OPEN_INODES, most recently closed first. */
+static struct list closed_inodes;
+static size_t closed_cnt;
+
+/* Protects OPEN_INODES, CLOSED_INODES and every inode's open and
+ * removed state.  Never held across disk I/O except while an inode
+ * is first read. */
+static struct lock inodes_lock;
+
+/* Most closed inodes kept. */
+#define INODE_CACHE_SIZE 64
+
+static uint64_t
+inode_hash (const struct hash_elem *e, void *aux UNUSED) {
+	return hash_int (hash_entry (e, struct inode, elem)->sector);
+}
+
+static bool
+inode_less (const struct hash_elem *a, const struct hash_elem *b,
+		void *aux UNUSED) {
+	return hash_entry (a, struct inode, elem)->sector
+		< hash_entry (b, struct inode, elem)->sector;
+}
 
 /* Initializes the inode module. */
 void
 inode_init (void) {
-	list_init (&open_inodes);
+	hash_init (&open_inodes, inode_hash, inode_less, NULL);
+	list_init (&closed_inodes);
+	closed_cnt = 0;
+	lock_init (&inodes_lock);
 }
 
 /* Initializes an inode with LENGTH bytes of data and
@@ -66,74 +678,104 @@ inode_init (void) {
  * Returns false if memory or disk allocation fails. */
 bool
 inode_create (disk_sector_t sector, off_t length) {
-	struct inode_disk *disk_inode = NULL;
-	bool success = false;
+	struct inode *inode;
+	bool success;
 
 	ASSERT (length >= 0);
 
 	/* If this assertion fails, the inode structure is not exactly
 	 * one sector in size, and you should fix that. */
-	ASSERT (sizeof *disk_inode == DISK_SECTOR_SIZE);
-
-	disk_inode = calloc (1, sizeof *disk_inode);
-	if (disk_inode != NULL) {
-		size_t sectors = bytes_to_sectors (length);
-		disk_inode->length = length;
-		disk_inode->magic = INODE_MAGIC;
-		if (free_map_allocate (sectors, &disk_inode->start)) {
-			disk_write (filesys_disk, sector, disk_inode);
-			if (sectors > 0) {
-				static char zeros[DISK_SECTOR_SIZE];
-				size_t i;
-
-				for (i = 0; i < sectors; i++) 
-					disk_write (filesys_disk, disk_inode->start + i, zeros); 
-			}
-			success = true; 
-		} 
-		free (disk_inode);
-	}
+	ASSERT (sizeof inode->data == DISK_SECTOR_SIZE);
+
+	/* Build the inode in memory, starting out empty, and grow it. */
+	inode = calloc (1, sizeof *inode);
+	if (inode == NULL)
+		return false;
+	inode->sector = sector;
+	inode->data.magic = INODE_MAGIC;
+	success = inode_grow (inode, length);
+	if (!success)
+		inode_release (inode);
+	inode_free (inode);
 	return success;
 }
 
+/* Returns the inode for SECTOR in the inode table, reopened, or a
+ * null pointer if there is none.
+ * Must be called with INODES_LOCK held. */
+static struct inode *
+inode_find (disk_sector_t sector) {
+	struct inode key;
+	struct hash_elem *e;
+	struct inode *inode;
+
+	key.sector = sector;
+	e = hash_find (&open_inodes, &key.elem);
+	if (e == NULL)
+		return NULL;
+	inode = hash_entry (e, struct inode, elem);
+	if (inode->open_cnt == 0) {
+		list_remove (&inode->lru_elem);
+		closed_cnt--;
+	}
+	inode->open_cnt++;
+	return inode;
+}
+
 /* Reads an inode from SECTOR
  * and returns a `struct inode' that contains it.
  * Returns a null pointer if memory allocation fails. */
 struct inode *
 inode_open (disk_sector_t sector) {
-	struct list_elem *e;
-	struct inode *inode;
+	struct inode *inode, *other;
 
-	/* Check whether this inode is already open. */
-	for (e = list_begin (&open_inodes); e != list_end (&open_inodes);
-			e = list_next (e)) {
-		inode = list_entry (e, struct inode, elem);
-		if (inode->sector == sector) {
-			inode_reopen (inode);
-			return inode; 
-		}
-	}
+	/* Check whether this inode is already open, or was closed only
+	 * lately. */
+	lock_acquire (&inodes_lock);
+	inode = inode_find (sector);
+	lock_release (&inodes_lock);
+	if (inode != NULL)
+		return inode;
 
 	/* Allocate memory. */
 	inode = malloc (sizeof *inode);
 	if (inode == NULL)
 		return NULL;
 
-	/* Initialize. */
-	list_push_front (&open_inodes, &inode->elem);
+	/* Initialize, reading the inode without holding the table lock. */
 	inode->sector = sector;
 	inode->open_cnt = 1;
 	inode->deny_write_cnt = 0;
 	inode->removed = false;
-	disk_read (filesys_disk, inode->sector, &inode->data);
+	rwlock_init (&inode->rwlock);
+	lock_init (&inode->dir_lock);
+	page_cache_read (inode->sector, &inode->data, 0, DISK_SECTOR_SIZE);
+	if (!inode_load (inode)) {
+		inode_free (inode);
+		return NULL;
+	}
+
+	/* Someone else may have opened it meanwhile. */
+	lock_acquire (&inodes_lock);
+	other = inode_find (sector);
+	if (other == NULL)
+		hash_insert (&open_inodes, &inode->elem);
+	lock_release (&inodes_lock);
+	if (other != NULL) {
+		inode_free (inode);
+		return other;
+	}
 	return inode;
 }
 
 /* Reopens and returns INODE. */
 struct inode *
 inode_reopen (struct inode *inode) {
-	if (inode != NULL)
+	if (inode != NULL) {
+		lock_acquire (&inodes_lock);
 		inode->open_cnt++;
+		lock_release (&inodes_lock);
+	}
 	return inode;
 }
 
@@ -153,19 +795,32 @@ inode_close (struct inode *inode) {
 		return;
 
 	/* Release resources if this was the last opener. */
+	lock_acquire (&inodes_lock);
 	if (--inode->open_cnt == 0) {
-		/* Remove from inode list and release lock. */
-		list_remove (&inode->elem);
-
-		/* Deallocate blocks if removed. */
+		/* Deallocate blocks if removed, once no one can find it. */
 		if (inode->removed) {
+			hash_delete (&open_inodes, &inode->elem);
+			lock_release (&inodes_lock);
 			free_map_release (inode->sector, 1);
-			free_map_release (inode->data.start,
-					bytes_to_sectors (inode->data.length)); 
+			inode_release (inode);
+			inode_free (inode); 
+			return;
 		}
 
-		free (inode); 
+		/* Otherwise keep it for a while, making room by freeing the
+		 * inode closed longest ago.  Only inodes that were not removed
+		 * are kept, so none of them owns sectors that are free. */
+		list_push_front (&closed_inodes, &inode->lru_elem);
+		if (++closed_cnt > INODE_CACHE_SIZE) {
+			struct inode *victim = list_entry (list_pop_back (&closed_inodes),
+					struct inode, lru_elem);
+
+			closed_cnt--;
+			hash_delete (&open_inodes, &victim->elem);
+			inode_free (victim);
+		}
 	}
+	lock_release (&inodes_lock);
 }
 
 /* Marks INODE to be deleted when it is closed by the last caller who
@@ -173,18 +828,70 @@ inode_close (struct inode *inode) {
 void
 inode_remove (struct inode *inode) {
 	ASSERT (inode != NULL);
+	lock_acquire (&inodes_lock);
 	inode->removed = true;
+	lock_release (&inodes_lock);
+}
+
+/* Acquires INODE's directory lock, which directory.c holds across
+ * each operation on the directory that INODE holds. */
+void
+inode_lock_dir (struct inode *inode) {
+	lock_acquire (&inode->dir_lock);
+}
+
+/* Releases INODE's directory lock. */
+void
+inode_unlock_dir (struct inode *inode) {
+	lock_release (&inode->dir_lock);
+}
+
+/* Returns how many whole sectors of INODE, starting with the one at
+ * OFFSET, which is FIRST, lie at consecutive disk sectors within the
+ * next SIZE bytes, up to DISK_MULTI_MAX.  OFFSET must be the start of
+ * a sector. */
+static size_t
+sector_run (struct inode *inode, disk_sector_t first, off_t offset,
+		off_t size) {
+	size_t cnt = 1;
+
+	while (cnt < DISK_MULTI_MAX
+			&& (off_t) (cnt + 1) * DISK_SECTOR_SIZE <= size
+			&& byte_to_sector (inode, offset + cnt * DISK_SECTOR_SIZE)
+				== first + cnt)
+		cnt++;
+	return cnt;
+}
+
+/* Returns the number of bytes, a multiple of DISK_SECTOR_SIZE, that an
+ * access of SIZE bytes at OFFSET of INODE, which maps to SECTOR, can
+ * move with one direct disk request, or 0 if it should go through the
+ * cache.  INODE_LEFT is the number of bytes from OFFSET to end of
+ * file. */
+static off_t
+direct_bytes (struct inode *inode, disk_sector_t sector, off_t offset,
+		off_t size, off_t inode_left) {
+	off_t left = size < inode_left ? size : inode_left;
+	size_t cnt;
+
+	if (sector == 0 || offset % DISK_SECTOR_SIZE != 0
+			|| left < DIRECT_MIN * DISK_SECTOR_SIZE)
+		return 0;
+	cnt = sector_run (inode, sector, offset, left);
+	return cnt >= DIRECT_MIN ? (off_t) cnt * DISK_SECTOR_SIZE : 0;
 }
 
 /* Reads SIZE bytes from INODE into BUFFER, starting at position OFFSET.
  * Returns the number of bytes actually read, which may be less
- * than SIZE if an error occurs or end of file is reached. */
+ * than SIZE if an error occurs or end of file is reached.
+ * Any number of reads, and writes that do not extend the file, may
+ * run at once, each waiting only for the sectors it needs. */
 off_t
 inode_read_at (struct inode *inode, void *buffer_, off_t size, off_t offset) {
 	uint8_t *buffer = buffer_;
 	off_t bytes_read = 0;
-	uint8_t *bounce = NULL;
 	
+	rwlock_acquire_read (&inode->rwlock);
 	while (size > 0) {
 
 		/* Disk sector to read, starting byte offset within sector. */
@@ -198,23 +905,23 @@ inode_read_at (struct inode *inode, void *buffer_, off_t size, off_t offset) {
 
 		/* Number of bytes to actually copy out of this sector. */
 		int chunk_size = size < min_left ? size : min_left;
+		off_t direct;
 		if (chunk_size <= 0)
 			break;
 		
-		if (sector_ofs == 0 && chunk_size == DISK_SECTOR_SIZE) {
-			/* Read full sector directly into caller's buffer. */
-			disk_read (filesys_disk, sector_idx, buffer + bytes_read); 
-		} else {
-			/* Read sector into bounce buffer, then partially copy
-			 * into caller's buffer. */
-			if (bounce == NULL) {
-				bounce = malloc (DISK_SECTOR_SIZE);
-				if (bounce == NULL)
-					break;
-			}
-			disk_read (filesys_disk, sector_idx, bounce);
-			memcpy (buffer + bytes_read, bounce + sector_ofs, chunk_size);
-		}
+		/* Read a long run of whole sectors straight into BUFFER.
+		 * Otherwise copy the sector, or the part of it we want, out of
+		 * the cache.  A hole reads as zeros. */
+		direct = direct_bytes (inode, sector_idx, offset, size, inode_left);
+		if (direct > 0) {
+			page_cache_read_direct (sector_idx, direct / DISK_SECTOR_SIZE,
+					buffer + bytes_read);
+			chunk_size = direct;
+		} else if (sector_idx == 0)
+			memset (buffer + bytes_read, 0, chunk_size);
+		else
+			page_cache_read (sector_idx, buffer + bytes_read, sector_ofs,
+					chunk_size);
 
 		/* Advance. */
 		size -= chunk_size;
@@ -222,26 +929,56 @@ inode_read_at (struct inode *inode, void *buffer_, off_t size, off_t offset) {
 		bytes_read += chunk_size;
 
 	}
-	free (bounce);
+
+	/* Read the sector after the last one ahead, in the background. */
+	if (bytes_read > 0) {
+		off_t next = ROUND_UP (offset, DISK_SECTOR_SIZE);
+
+		if (next < inode_length (inode)) {
+			disk_sector_t sector = byte_to_sector (inode, next);
+
+			if (sector != 0)
+				page_cache_readahead_sector (sector);
+		}
+	}
+	rwlock_release_read (&inode->rwlock);
 
 	return bytes_read;
 }
 
 /* Writes SIZE bytes from BUFFER into INODE, starting at OFFSET.
+ * A write past end of file extends the inode first, and a write
+ * into a hole fills it.
  * Returns the number of bytes actually written, which may be
- * less than SIZE if end of file is reached or an error occurs.
- * (Normally a write at end of file would extend the inode, but
- * growth is not yet implemented.) */
+ * less than SIZE if the disk is full or an error occurs. */
 off_t
 inode_write_at (struct inode *inode, const void *buffer_, off_t size,
 		off_t offset) {
 	const uint8_t *buffer = buffer_;
 	off_t bytes_written = 0;
-	uint8_t *bounce = NULL;
+	bool denied, extend;
 
-	if (inode->deny_write_cnt)
+	/* Writes are denied and allowed under the table lock. */
+	lock_acquire (&inodes_lock);
+	denied = inode->deny_write_cnt > 0;
+	lock_release (&inodes_lock);
+	if (denied)
 		return 0;
 
+	/* A write that extends the file excludes everyone else until its
+	 * data is in place, so that no reader sees the new length before
+	 * the new bytes.  Files never shrink, so a write found not to
+	 * extend the file cannot come to. */
+	extend = offset + size > inode_length (inode);
+	if (extend)
+		rwlock_acquire_write (&inode->rwlock);
+	else
+		rwlock_acquire_read (&inode->rwlock);
+
+	/* Make room for the write, which may extend the file.  If the disk
+	 * is full, write what fits. */
+	size = inode_reserve (inode, offset, size, extend);
+
 	while (size > 0) {
 		/* Sector to write, starting byte offset within sector. */
 		disk_sector_t sector_idx = byte_to_sector (inode, offset);
@@ -254,38 +991,33 @@ inode_write_at (struct inode *inode, const void *buffer_, off_t size,
 
 		/* Number of bytes to actually write into this sector. */
 		int chunk_size = size < min_left ? size : min_left;
+		off_t direct;
 		if (chunk_size <= 0)
 			break;
 
-		if (sector_ofs == 0 && chunk_size == DISK_SECTOR_SIZE) {
-			/* Write full sector directly to disk. */
-			disk_write (filesys_disk, sector_idx, buffer + bytes_written); 
-		} else {
-			/* We need a bounce buffer. */
-			if (bounce == NULL) {
-				bounce = malloc (DISK_SECTOR_SIZE);
-				if (bounce == NULL)
-					break;
-			}
-
-			/* If the sector contains data before or after the chunk
-			   we're writing, then we need to read in the sector
-			   first.  Otherwise we start with a sector of all zeros. */
-			if (sector_ofs > 0 || chunk_size < sector_left) 
-				disk_read (filesys_disk, sector_idx, bounce);
-			else
-				memset (bounce, 0, DISK_SECTOR_SIZE);
-			memcpy (bounce + sector_ofs, buffer + bytes_written, chunk_size);
-			disk_write (filesys_disk, sector_idx, bounce); 
-		}
+		/* Write a long run of whole sectors straight from BUFFER.
+		 * Otherwise write into the cache, which reads in the rest of
+		 * the sector first if the chunk does not cover all of it.  The
+		 * sector reaches the disk later (see page_cache.c). */
+		direct = direct_bytes (inode, sector_idx, offset, size, inode_left);
+		if (direct > 0) {
+			page_cache_write_direct (sector_idx, direct / DISK_SECTOR_SIZE,
+					buffer + bytes_written);
+			chunk_size = direct;
+		} else
+			page_cache_write (sector_idx, buffer + bytes_written, sector_ofs,
+					chunk_size);
 
 		/* Advance. */
 		size -= chunk_size;
 		offset += chunk_size;
 		bytes_written += chunk_size;
 	}
-	free (bounce);
 
+	if (extend)
+		rwlock_release_write (&inode->rwlock);
+	else
+		rwlock_release_read (&inode->rwlock);
 	return bytes_written;
 }
 
@@ -294,8 +1026,10 @@ inode_write_at (struct inode *inode, const void *buffer_, off_t size,
 	void
 inode_deny_write (struct inode *inode) 
 {
+	lock_acquire (&inodes_lock);
 	inode->deny_write_cnt++;
 	ASSERT (inode->deny_write_cnt <= inode->open_cnt);
+	lock_release (&inodes_lock);
 }
 
 /* Re-enables writes to INODE.
@@ -303,9 +1037,11 @@ inode_deny_write (struct inode *inode)
  * inode_deny_write() on the inode, before closing the inode. */
 void
 inode_allow_write (struct inode *inode) {
+	lock_acquire (&inodes_lock);
 	ASSERT (inode->deny_write_cnt > 0);
 	ASSERT (inode->deny_write_cnt <= inode->open_cnt);
 	inode->deny_write_cnt--;
+	lock_release (&inodes_lock);
 }
 
 /* Returns the length, in bytes, of INODE's data. */
@@ -1,9 +1,44 @@
-/* page_cache.c: Implementation of Page Cache (Buffer Cache). */
+/* page_cache.c: Implementation of Page Cache (Buffer Cache).
+ *
+ * Every sector the file system reads or writes goes through a cache of
+ * PAGE_CACHE_SIZE sectors.  Reads are served from the cache, and
+ * writes only dirty the cached copy: the page_cache_kworkerd daemon
+ * writes dirty sectors back every FLUSH_INTERVAL ticks, eviction
+ * writes back a dirty victim, and filesys_done() writes back the rest.
+ * Victims are chosen by the clock algorithm.  After a sector of a file
+ * is read, the next one is read ahead by the "readahead" daemon.
+ *
+ * Large transfers of whole sectors that lie next to each other on disk
+ * bypass the cache: page_cache_read_direct() and
+ * page_cache_write_direct() move them with one multi-sector request,
+ * keeping any cached copies coherent.  Buffers are kernel memory, so
+ * the disk never waits on a page fault; read() and write() copy user
+ * data through a kernel buffer of their own.
+ *
+ * CACHE_LOCK protects the tags (which sector each entry holds), the
+ * pin counts and the clock hand.  Each entry's own lock protects its
+ * data and its valid and dirty bits, and is held across disk I/O on
+ * the entry.  An entry is pinned while someone waits for or holds its
+ * lock, and pinned entries are never evicted.  No disk I/O happens
+ * under CACHE_LOCK: a dirty victim is retagged at once and written back
+ * by the thread that claimed it under the entry's lock alone, and until
+ * then anyone who wants the old sector waits for that lock. */
 
+#include "filesys/page_cache.h"
 #include "vm/vm.h"
+#include <debug.h>
+#include <stdio.h>
+#include <string.h>
+#include "devices/timer.h"
+#include "filesys/filesys.h"
+#include "threads/palloc.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
 static bool page_cache_readahead (struct page *page, void *kva);
 static bool page_cache_writeback (struct page *page);
 static void page_cache_destroy (struct page *page);
+static void page_cache_kworkerd (void *aux);
 
 /* DO NOT MODIFY this struct */
 static const struct page_operations page_cache_op = {
@@ -18,7 +53,8 @@ tid_t page_cache_workerd;
 /* The initializer of file vm */
 void
 pagecache_init (void) {
-	/* TODO: Create a worker daemon for page cache with page_cache_kworkerd */
+	/* The sector cache and its daemons are set up by page_cache_init(),
+	 * which filesys_init() calls before the VM is initialized. */
 }
 
 /* Initialize the page cache */
@@ -44,7 +80,414 @@ static void
 page_cache_destroy (struct page *page) {
 }
 
+/* Sector cache. */
+
+/* Cached sectors. */
+#define PAGE_CACHE_SIZE 64
+
+/* Ticks between two write-backs of the dirty sectors. */
+#define FLUSH_INTERVAL (5 * TIMER_FREQ)
+
+/* Most read-ahead requests waiting for the daemon. */
+#define READAHEAD_MAX 16
+
+/* Tag of an entry that holds no sector. */
+#define SECTOR_NONE ((disk_sector_t) -1)
+
+/* A cached sector. */
+struct cache_entry {
+	disk_sector_t sector;       /* Cached sector, or SECTOR_NONE. */
+	disk_sector_t old_sector;   /* Sector being written back from DATA,
+								   or SECTOR_NONE. */
+	int pin_cnt;                /* Users of the entry; 0 if evictable. */
+	bool accessed;              /* Used since the clock hand last passed. */
+	struct lock lock;           /* Protects the fields below. */
+	bool valid;                 /* DATA holds the sector's contents. */
+	bool dirty;                 /* DATA is newer than the disk. */
+	uint8_t *data;              /* DISK_SECTOR_SIZE bytes. */
+};
+
+static struct cache_entry cache[PAGE_CACHE_SIZE];
+static struct lock cache_lock;
+static size_t clock_hand;
+
+/* Sectors to read ahead, a ring protected by CACHE_LOCK. */
+static disk_sector_t readahead_queue[READAHEAD_MAX];
+static size_t readahead_head, readahead_len;
+static struct semaphore readahead_sema;
+
+/* Statistics. */
+static long long hit_cnt;           /* Accesses that found the sector. */
+static long long miss_cnt;          /* Accesses that read the disk. */
+static long long readahead_cnt;     /* Sectors read ahead. */
+static long long writeback_cnt;     /* Dirty sectors written back. */
+static long long direct_cnt;        /* Direct transfers. */
+static long long direct_sectors;    /* Sectors moved by them. */
+
+static void readahead_daemon (void *aux);
+
+/* Initializes the sector cache and starts its daemons. */
+void
+page_cache_init (void) {
+	size_t i;
+
+	lock_init (&cache_lock);
+	sema_init (&readahead_sema, 0);
+	for (i = 0; i < PAGE_CACHE_SIZE; i++) {
+		struct cache_entry *e = &cache[i];
+
+		/* Eight sectors fit in a page. */
+		if (i % (PGSIZE / DISK_SECTOR_SIZE) == 0)
+			e->data = palloc_get_page (PAL_ASSERT);
+		else
+			e->data = cache[i - 1].data + DISK_SECTOR_SIZE;
+		e->sector = SECTOR_NONE;
+		e->old_sector = SECTOR_NONE;
+		e->pin_cnt = 0;
+		e->accessed = false;
+		lock_init (&e->lock);
+		e->valid = false;
+		e->dirty = false;
+	}
+	clock_hand = 0;
+
+	page_cache_workerd = thread_create ("kworkerd", PRI_DEFAULT,
+			page_cache_kworkerd, NULL);
+	thread_create ("readahead", PRI_DEFAULT, readahead_daemon, NULL);
+}
+
+/* Prints sector cache statistics. */
+void
+page_cache_print_stats (void) {
+	printf ("Cache: %lld hits, %lld misses, %lld read ahead, "
+			"%lld written back\n",
+			hit_cnt, miss_cnt, readahead_cnt, writeback_cnt);
+	printf ("Cache: %lld direct transfers of %lld sectors\n",
+			direct_cnt, direct_sectors);
+}
+
+/* Returns the entry that holds SECTOR, or a null pointer.
+ * Must be called with CACHE_LOCK held. */
+static struct cache_entry *
+cache_lookup (disk_sector_t sector) {
+	size_t i;
+
+	for (i = 0; i < PAGE_CACHE_SIZE; i++)
+		if (cache[i].sector == sector)
+			return &cache[i];
+	return NULL;
+}
+
+/* Returns the entry whose old contents, those of SECTOR, are being
+ * written back, or a null pointer.
+ * Must be called with CACHE_LOCK held. */
+static struct cache_entry *
+cache_lookup_old (disk_sector_t sector) {
+	size_t i;
+
+	for (i = 0; i < PAGE_CACHE_SIZE; i++)
+		if (cache[i].old_sector == sector)
+			return &cache[i];
+	return NULL;
+}
+
+/* Picks an unpinned entry by the clock algorithm and returns it
+ * locked, its data no longer valid.  If it was dirty, its old sector
+ * is left in OLD_SECTOR for the caller to write back once CACHE_LOCK
+ * is released.  Returns a null pointer if every entry is pinned.
+ * Must be called with CACHE_LOCK held. */
+static struct cache_entry *
+cache_evict (void) {
+	size_t i;
+
+	for (i = 0; i < 2 * PAGE_CACHE_SIZE; i++) {
+		struct cache_entry *e = &cache[clock_hand];
+
+		clock_hand = (clock_hand + 1) % PAGE_CACHE_SIZE;
+		if (e->pin_cnt > 0)
+			continue;
+		if (e->accessed) {
+			e->accessed = false;
+			continue;
+		}
+
+		/* No one holds the lock of an unpinned entry, so this does not
+		 * block. */
+		lock_acquire (&e->lock);
+		if (e->dirty) {
+			e->old_sector = e->sector;
+			writeback_cnt++;
+		}
+		e->valid = false;
+		return e;
+	}
+	return NULL;
+}
+
+/* Returns the entry for SECTOR, locked and pinned.  If READ is true,
+ * the entry holds the sector's contents; otherwise the caller is about
+ * to overwrite all of it and the entry may be invalid.  Sets *HIT to
+ * whether the sector was already cached. */
+static struct cache_entry *
+cache_get (disk_sector_t sector, bool read, bool *hit) {
+	struct cache_entry *e;
+
+	ASSERT (sector != SECTOR_NONE);
+
+	lock_acquire (&cache_lock);
+	for (;;) {
+		e = cache_lookup (sector);
+		if (e != NULL) {
+			*hit = true;
+			hit_cnt++;
+			break;
+		}
+		e = cache_lookup_old (sector);
+		if (e != NULL) {
+			/* SECTOR's newest contents are still on their way to the
+			 * disk: wait for them to get there. */
+			e->pin_cnt++;
+			lock_release (&cache_lock);
+			lock_acquire (&e->lock);
+			lock_release (&e->lock);
+			lock_acquire (&cache_lock);
+			e->pin_cnt--;
+			continue;
+		}
+		e = cache_evict ();
+		if (e != NULL) {
+			e->sector = sector;
+			*hit = false;
+			miss_cnt++;
+			break;
+		}
+		/* Every entry is in use: wait for one to be released. */
+		lock_release (&cache_lock);
+		thread_yield ();
+		lock_acquire (&cache_lock);
+	}
+	e->pin_cnt++;
+	e->accessed = true;
+	lock_release (&cache_lock);
+
+	/* cache_evict() returned the entry locked. */
+	if (*hit)
+		lock_acquire (&e->lock);
+	ASSERT (e->sector == sector);
+	if (e->old_sector != SECTOR_NONE) {
+		disk_write (filesys_disk, e->old_sector, e->data);
+		e->old_sector = SECTOR_NONE;
+		e->dirty = false;
+	}
+	if (read && !e->valid) {
+		disk_read (filesys_disk, sector, e->data);
+		e->valid = true;
+	}
+	return e;
+}
+
+/* Unlocks and unpins entry E. */
+static void
+cache_put (struct cache_entry *e) {
+	lock_release (&e->lock);
+	lock_acquire (&cache_lock);
+	e->pin_cnt--;
+	lock_release (&cache_lock);
+}
+
+/* Reads SIZE bytes at offset OFS of SECTOR into BUFFER. */
+void
+page_cache_read (disk_sector_t sector, void *buffer, off_t ofs, size_t size) {
+	struct cache_entry *e;
+	bool hit;
+
+	ASSERT (ofs >= 0 && ofs + size <= DISK_SECTOR_SIZE);
+
+	e = cache_get (sector, true, &hit);
+	memcpy (buffer, e->data + ofs, size);
+	cache_put (e);
+}
+
+/* Writes SIZE bytes from BUFFER at offset OFS of SECTOR.  The sector
+ * is only read from the disk if the write does not cover all of it. */
+void
+page_cache_write (disk_sector_t sector, const void *buffer, off_t ofs,
+		size_t size) {
+	struct cache_entry *e;
+	bool hit;
+
+	ASSERT (ofs >= 0 && ofs + size <= DISK_SECTOR_SIZE);
+
+	e = cache_get (sector, size < DISK_SECTOR_SIZE, &hit);
+	memcpy (e->data + ofs, buffer, size);
+	e->valid = true;
+	e->dirty = true;
+	cache_put (e);
+}
+
+/* Brings the cached copies of the CNT sectors starting at SECTOR in
+ * line with a direct transfer.  With DATA null, before a direct read,
+ * dirty copies are written back so that the disk holds the newest
+ * contents.  Otherwise DATA holds the sectors' new contents, which the
+ * cached copies take, clean: done before a direct write, no older
+ * dirty copy can be written back over the new data, and done after, no
+ * copy read in during the write is left stale. */
+static void
+cache_sync_range (disk_sector_t sector, size_t cnt, const uint8_t *data) {
+	size_t i;
+
+	for (i = 0; i < PAGE_CACHE_SIZE; i++) {
+		struct cache_entry *e = &cache[i];
+		bool written = false;
+
+		/* SECTOR_NONE is never in range.  An entry whose old contents
+		 * are in range is waited for, so that writing them back cannot
+		 * race with the direct transfer. */
+		lock_acquire (&cache_lock);
+		if (e->sector - sector >= cnt && e->old_sector - sector >= cnt) {
+			lock_release (&cache_lock);
+			continue;
+		}
+		e->pin_cnt++;
+		lock_release (&cache_lock);
+
+		lock_acquire (&e->lock);
+		if (e->sector - sector >= cnt)
+			;   /* Only the old contents were in range; now on disk. */
+		else if (data != NULL) {
+			memcpy (e->data, data + (e->sector - sector) * DISK_SECTOR_SIZE,
+					DISK_SECTOR_SIZE);
+			e->valid = true;
+			e->dirty = false;
+		} else if (e->dirty) {
+			disk_write (filesys_disk, e->sector, e->data);
+			e->dirty = false;
+			written = true;
+		}
+		lock_release (&e->lock);
+
+		lock_acquire (&cache_lock);
+		e->pin_cnt--;
+		if (written)
+			writeback_cnt++;
+		lock_release (&cache_lock);
+	}
+}
+
+/* Counts a direct transfer of CNT sectors. */
+static void
+count_direct (size_t cnt) {
+	lock_acquire (&cache_lock);
+	direct_cnt++;
+	direct_sectors += cnt;
+	lock_release (&cache_lock);
+}
+
+/* Reads the CNT sectors starting at SECTOR into BUFFER, bypassing the
+ * cache, with as few disk requests as possible. */
+void
+page_cache_read_direct (disk_sector_t sector, size_t cnt, void *buffer) {
+	ASSERT (cnt <= DISK_MULTI_MAX);
+	ASSERT (is_kernel_vaddr (buffer));
+
+	cache_sync_range (sector, cnt, NULL);
+	disk_read_multi (filesys_disk, sector, cnt, buffer);
+	count_direct (cnt);
+}
+
+/* Writes the CNT sectors starting at SECTOR from BUFFER, bypassing the
+ * cache, with as few disk requests as possible.  Cached copies of the
+ * sectors are updated rather than dropped. */
+void
+page_cache_write_direct (disk_sector_t sector, size_t cnt,
+		const void *buffer) {
+	ASSERT (cnt <= DISK_MULTI_MAX);
+	ASSERT (is_kernel_vaddr (buffer));
+
+	cache_sync_range (sector, cnt, buffer);
+	disk_write_multi (filesys_disk, sector, cnt, buffer);
+	cache_sync_range (sector, cnt, buffer);
+	count_direct (cnt);
+}
+
+/* Asks the read-ahead daemon to bring SECTOR into the cache, unless it
+ * is cached already.  Does not wait; the request is dropped if too
+ * many are waiting. */
+void
+page_cache_readahead_sector (disk_sector_t sector) {
+	lock_acquire (&cache_lock);
+	if (cache_lookup (sector) == NULL && readahead_len < READAHEAD_MAX) {
+		readahead_queue[(readahead_head + readahead_len++) % READAHEAD_MAX]
+			= sector;
+		sema_up (&readahead_sema);
+	}
+	lock_release (&cache_lock);
+}
+
+/* Reads ahead the sectors that page_cache_readahead_sector() asked
+ * for. */
+static void
+readahead_daemon (void *aux UNUSED) {
+	for (;;) {
+		struct cache_entry *e;
+		disk_sector_t sector;
+		bool hit;
+
+		sema_down (&readahead_sema);
+		lock_acquire (&cache_lock);
+		sector = readahead_queue[readahead_head];
+		readahead_head = (readahead_head + 1) % READAHEAD_MAX;
+		readahead_len--;
+		lock_release (&cache_lock);
+
+		e = cache_get (sector, true, &hit);
+		cache_put (e);
+		if (!hit) {
+			lock_acquire (&cache_lock);
+			readahead_cnt++;
+			lock_release (&cache_lock);
+		}
+	}
+}
+
+/* Writes every dirty sector in the cache back to the disk. */
+void
+page_cache_flush (void) {
+	size_t i;
+
+	for (i = 0; i < PAGE_CACHE_SIZE; i++) {
+		struct cache_entry *e = &cache[i];
+		bool written;
+
+		lock_acquire (&cache_lock);
+		if (e->sector == SECTOR_NONE) {
+			lock_release (&cache_lock);
+			continue;
+		}
+		e->pin_cnt++;
+		lock_release (&cache_lock);
+
+		lock_acquire (&e->lock);
+		written = e->dirty;
+		if (e->dirty) {
+			disk_write (filesys_disk, e->sector, e->data);
+			e->dirty = false;
+		}
+		lock_release (&e->lock);
+
+		lock_acquire (&cache_lock);
+		e->pin_cnt--;
+		if (written)
+			writeback_cnt++;
+		lock_release (&cache_lock);
+	}
+}
+
 /* Worker thread for page cache */
 static void
-page_cache_kworkerd (void *aux) {
+page_cache_kworkerd (void *aux UNUSED) {
+	for (;;) {
+		timer_sleep (FLUSH_INTERVAL);
+		page_cache_flush ();
+	}
 }
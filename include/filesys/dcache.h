@@ -0,0 +1,17 @@
+#ifndef FILESYS_DCACHE_H
+#define FILESYS_DCACHE_H
+
+#include <stdbool.h>
+#include "devices/disk.h"
+
+/* Inode sector of a name known not to exist. */
+#define DCACHE_NEGATIVE ((disk_sector_t) -1)
+
+void dcache_init (void);
+bool dcache_lookup (disk_sector_t dir, const char *name,
+		disk_sector_t *sectorp);
+void dcache_insert (disk_sector_t dir, const char *name, disk_sector_t sector);
+void dcache_invalidate_dir (disk_sector_t dir);
+void dcache_print_stats (void);
+
+#endif /* filesys/dcache.h */
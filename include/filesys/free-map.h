@@ -13,5 +13,7 @@ void free_map_close (void);
 
 bool free_map_allocate (size_t, disk_sector_t *);
 void free_map_release (disk_sector_t, size_t);
+size_t free_map_allocate_run (size_t cnt, disk_sector_t hint,
+		disk_sector_t *sectorp);
 
 #endif /* filesys/free-map.h */
@@ -1,6 +1,9 @@
 #ifndef FILESYS_PAGE_CACHE_H
 #define FILESYS_PAGE_CACHE_H
-#include "vm/vm.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include "devices/disk.h"
+#include "filesys/off_t.h"
 
 struct page;
 enum vm_type;
@@ -9,4 +12,15 @@ struct page_cache {};
 
 void page_cache_init (void);
 bool page_cache_initializer (struct page *page, enum vm_type type, void *kva);
+
+void page_cache_read (disk_sector_t sector, void *buffer, off_t ofs,
+		size_t size);
+void page_cache_write (disk_sector_t sector, const void *buffer, off_t ofs,
+		size_t size);
+void page_cache_read_direct (disk_sector_t sector, size_t cnt, void *buffer);
+void page_cache_write_direct (disk_sector_t sector, size_t cnt,
+		const void *buffer);
+void page_cache_readahead_sector (disk_sector_t sector);
+void page_cache_flush (void);
+void page_cache_print_stats (void);
 #endif
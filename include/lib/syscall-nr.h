@@ -22,6 +22,11 @@ enum {
 	/* Project 3 and optionally project 4. */
 	SYS_MMAP,                   /* Map a file into memory. */
 	SYS_MUNMAP,                 /* Remove a memory mapping. */
+	SYS_MSYNC,                  /* Write back a memory mapping. */
+	SYS_MADVISE,                /* Give advice about use of memory. */
+	SYS_MLOCK,                  /* Lock memory in RAM. */
+	SYS_MUNLOCK,                /* Unlock memory. */
+	SYS_SBRK,                   /* Grow or shrink the heap. */
 
 	/* Project 4 only. */
 	SYS_CHDIR,                  /* Change the current directory. */
@@ -38,4 +43,11 @@ enum {
 	SYS_UMOUNT,
 };
 
+/* Advice for madvise(). */
+#define MADV_NORMAL 0           /* No special treatment. */
+#define MADV_RANDOM 1           /* Expect random access: no readahead. */
+#define MADV_SEQUENTIAL 2       /* Expect sequential access. */
+#define MADV_WILLNEED 3         /* Will be accessed soon: prefetch. */
+#define MADV_DONTNEED 4         /* Not needed now: drop the pages. */
+
 #endif /* lib/syscall-nr.h */
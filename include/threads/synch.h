@@ -38,6 +38,22 @@ void cond_wait (struct condition *, struct lock *);
 void cond_signal (struct condition *, struct lock *);
 void cond_broadcast (struct condition *, struct lock *);
 
+/* Readers-writer lock. */
+struct rwlock {
+	struct lock lock;           /* Protects the members below. */
+	struct condition readers;   /* Readers waiting to enter. */
+	struct condition writers;   /* Writers waiting to enter. */
+	int reader_cnt;             /* Readers inside. */
+	int waiting_writer_cnt;     /* Writers waiting. */
+	bool writer;                /* A writer is inside? */
+};
+
+void rwlock_init (struct rwlock *);
+void rwlock_acquire_read (struct rwlock *);
+void rwlock_release_read (struct rwlock *);
+void rwlock_acquire_write (struct rwlock *);
+void rwlock_release_write (struct rwlock *);
+
 void donate_priority(void);
 void refresh_priority(void);
 
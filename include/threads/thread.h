@@ -119,6 +119,8 @@ struct thread
    int exit_flag; // 스레드 종료 확인을 위한 플래그
 
    struct file *running_file;
+   uint8_t *bounce;   /* Kernel buffer read() and write() copy through. */
+   size_t bounce_cnt; /* Pages in BOUNCE, 0 until first needed. */
 
    /* Shared between thread.c and synch.c. */
    struct list_elem elem; /* List element. */
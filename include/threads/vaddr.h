@@ -31,6 +31,15 @@
 /* Round down to nearest page boundary. */
 #define pg_round_down(va) (void *) ((uint64_t) (va) & ~PGMASK) /* 내부에서 va가 가리키는 가상 페이지의 시작 (페이지 오프셋이 0으로 설정된 va) 반환*/
 
+/* Huge page offset (bits 0:21), for 2 MiB pages. */
+#define HPGBITS 21                         /* Number of offset bits. */
+#define HPGSIZE (1ul << HPGBITS)           /* Bytes in a huge page. */
+#define HPGMASK BITMASK(PGSHIFT, HPGBITS)  /* Huge page offset bits (0:21). */
+#define HPG_PAGE_CNT (HPGSIZE / PGSIZE)    /* Pages in a huge page. */
+
+/* Round down to nearest huge page boundary. */
+#define hpg_round_down(va) (void *) ((uint64_t) (va) & ~HPGMASK)
+
 /* Kernel virtual address start */
 #define KERN_BASE LOADER_KERN_BASE /* 유저 가상 메모리(0~KERN_BASE), 커널 가상 메모리(나머지 부분)의 경계 */
 
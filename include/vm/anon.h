@@ -2,7 +2,11 @@
 #define VM_ANON_H
 #include "vm/vm.h"
 #include "kernel/bitmap.h"
+#include <stddef.h>
 struct page;
+struct text_page;
+struct zswap_entry;
+struct ksm_page;
 enum vm_type;
 
 // 💬 : 익명 페이지를 위해 우리가 기억해야 하는 필수적인 정보들
@@ -15,8 +19,24 @@ struct anon_page {
 	bool (*page_initializer) (struct page *, enum vm_type, void *kva);
 
 	int swap_index; //★★★ : swap 된 데이터들이 저장된 섹터 구역을 의미한다.
+	bool prefetched;        /* Read ahead from swap, not yet mapped. */
+	struct text_page *text; /* Shared text page mapped, if any. */
+	bool zero;              /* Maps the shared zero frame read-only. */
+	struct zswap_entry *zswap; /* Contents in the compressed pool. */
+	struct ksm_page *ksm;   /* Merged frame mapped read-only, if any. */
+	bool file_data;         /* Initialized with data from the executable. */
 };
+/* Most pages swapped out together with one disk write. */
+#define SWAP_CLUSTER_MAX 8
+
 void vm_anon_init (void);
 bool anon_initializer (struct page *page, enum vm_type type, void *kva);
+size_t anon_swap_out_cluster (struct page *pages[], size_t cnt);
+void anon_readahead_hit (struct page *page);
+bool anon_swap_write_page (struct page *page, const void *kva);
+int anon_swap_write_frame (const void *kva);
+void anon_swap_read_frame (int slot, void *kva);
+void anon_swap_free_frame (int slot);
+void anon_print_stats (void);
 
 #endif
@@ -4,6 +4,7 @@
 #include "vm/vm.h"
 
 struct page;
+struct supplemental_page_table;
 enum vm_type;
 
 struct file_page {
@@ -19,8 +20,12 @@ struct file_page {
 };
 
 void vm_file_init (void);
+void file_print_stats (void);
 bool file_backed_initializer (struct page *page, enum vm_type type, void *kva);
+void file_backed_teardown (struct supplemental_page_table *spt);
 void *do_mmap(void *addr, size_t length, int writable,
 		struct file *file, off_t offset);
+bool do_mmap_copy (struct page *first);
 void do_munmap (void *va);
+int do_msync (void *addr, size_t length);
 #endif
@@ -0,0 +1,17 @@
+#ifndef VM_TEXT_H
+#define VM_TEXT_H
+#include "vm/vm.h"
+
+struct page;
+struct lazy_load_file;
+struct text_page;
+
+void vm_text_init (void);
+bool text_claim_page (struct page *page, struct lazy_load_file *aux);
+bool text_share_page (struct page *page, struct text_page *tp);
+bool text_fault_in (struct page *page);
+bool text_unshare_page (struct page *page);
+void text_release_page (struct page *page);
+void text_print_stats (void);
+
+#endif
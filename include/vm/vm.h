@@ -51,6 +51,10 @@ struct page {
 	struct hash_elem hash_elem;
 	bool writable;
 	int seq_num;
+	bool locked;           /* Pinned in memory by mlock(). */
+	int advice;            /* MADV_* given by madvise(). */
+	struct thread *owner;  /* Process the page belongs to. */
+	struct list_elem mapper_elem; /* In a shared frame's MAPPERS. */
 
 	/* Per-type data are binded into the union.
 	 * Each function automatically detects the current union */
@@ -66,11 +70,21 @@ struct page {
 };
 
 
-/* The representation of "frame" */
+/* The representation of "frame".
+ * Frames live in the global frame table, one entry per user pool page,
+ * indexed by frame number (see vm.c).  A frame either holds the private
+ * page PAGE or is shared: it belongs to no page, and the pages that map
+ * it are on MAPPERS. */
 struct frame {
 	void *kva;
 	struct page *page;
-	struct list_elem frame_elem;
+	struct thread *owner;  /* Thread whose pml4 maps PAGE. */
+	struct list mappers;   /* Pages mapping a shared frame. */
+	struct ksm_page *ksm;  /* Merged page held, if any. */
+	struct frame **shared; /* Text cache slot holding it, if any. */
+	bool pinned;           /* True while the frame must not be evicted. */
+	bool io;               /* Being written out or read back. */
+	uint64_t ksm_sum;      /* Checksum at the last same-page merging scan. */
 };
 
 /* The function table for page operations.
@@ -97,6 +111,19 @@ struct page_operations {
 // 06.14 : 구현
 struct supplemental_page_table {
 	struct hash table;
+	void *fa_next;          /* First page past the last fault-around. */
+	size_t fa_window;       /* Pages to map around the next file fault. */
+
+	/* Page-fault-frequency frame allocation (see vm.c). */
+	int64_t pff_start;      /* Start of the current window, in ticks. */
+	size_t pff_faults;      /* Faults in the current window. */
+	size_t rss;             /* Frames holding pages of the process. */
+	size_t ws;              /* Working-set estimate, in pages. */
+	size_t quota;           /* Frames the process may keep under pressure. */
+
+	/* Heap grown by sbrk() (see vm.c). */
+	void *heap_start;       /* First page of the heap, NULL if none. */
+	void *heap_brk;         /* Current break. */
 };
 
 #include "threads/thread.h"
@@ -120,5 +147,28 @@ bool vm_alloc_page_with_initializer (enum vm_type type, void *upage,
 void vm_dealloc_page (struct page *page);
 bool vm_claim_page (void *va);
 enum vm_type page_get_type (struct page *page);
+struct frame *vm_get_frame (void);
+struct frame *vm_get_free_frame (void);
+void vm_attach_frame (struct page *page, struct frame *frame);
+struct frame *vm_pin_page (struct page *page);
+void vm_unpin_frame (struct frame *frame);
+void vm_release_frame (struct frame *frame);
+void vm_free_frame (struct frame *frame);
+void vm_free_anon_frame (struct page *page);
+bool vm_map_shared_page (struct page *page, struct frame **slot);
+bool vm_share_frame (struct frame *frame, struct frame **slot,
+		struct page *page);
+void vm_unmap_shared_page (struct page *page, struct frame **slot);
+void vm_free_shared_frame (struct frame **slot);
+int vm_madvise (void *addr, size_t length, int advice);
+int vm_mlock (const void *addr, size_t length, bool lock);
+void *vm_mmap_anon (void *addr, size_t length, bool writable);
+void vm_heap_init (void *heap_start);
+void *vm_sbrk (intptr_t increment);
+void vm_print_stats (void);
+
+extern bool vm_huge_pages;
+extern bool vm_pff;
+extern size_t vm_ksm_scan_rate;
 
 #endif  /* VM_VM_H */
@@ -0,0 +1,246 @@
+#include <malloc.h>
+#include <debug.h>
+#include <round.h>
+#include <stdint.h>
+#include <string.h>
+#include <syscall.h>
+
+/* A simple malloc() for user programs, on top of sbrk().
+
+   It works like the kernel's (see threads/malloc.c).  Each request,
+   in bytes, is rounded up to a power of 2 and served by the
+   "descriptor" for blocks of that size, which keeps a list of free
+   blocks.  When the list is empty, the heap is grown by one page, an
+   "arena", which is divided into blocks of that size.
+
+   Freed blocks go back on their descriptor's free list.  Arenas are
+   never given back, since only the top of the heap could be.
+
+   Blocks bigger than 1 kB get whole pages of their own, with the page
+   count in the arena header.  A freed big block at the top of the
+   heap is given back with sbrk(); any other is kept on a list and
+   reused for a later request that it fits.
+
+   User processes have a single thread, so there is no locking. */
+
+#define PGSIZE 4096
+
+/* Free block. */
+struct block {
+	struct block *next;         /* Next free block. */
+};
+
+/* Descriptor. */
+struct desc {
+	size_t block_size;          /* Size of each element in bytes. */
+	size_t blocks_per_arena;    /* Number of blocks in an arena. */
+	struct block *free_list;    /* List of free blocks. */
+};
+
+/* Magic number for detecting arena corruption. */
+#define ARENA_MAGIC 0x6d6c6c63
+
+/* Arena. */
+struct arena {
+	unsigned magic;             /* Always set to ARENA_MAGIC. */
+	struct desc *desc;          /* Owning descriptor, null for big block. */
+	size_t page_cnt;            /* Pages in big block. */
+	struct arena *next;         /* Next free big block. */
+};
+
+/* Our set of descriptors, for 16 to 1024 bytes. */
+static struct desc descs[7];
+static size_t desc_cnt;
+
+/* Free big blocks. */
+static struct arena *big_list;
+
+static void
+malloc_init (void) {
+	size_t block_size;
+
+	for (block_size = 16; block_size < PGSIZE / 2; block_size *= 2) {
+		struct desc *d = &descs[desc_cnt++];
+		ASSERT (desc_cnt <= sizeof descs / sizeof *descs);
+		d->block_size = block_size;
+		d->blocks_per_arena = (PGSIZE - sizeof (struct arena)) / block_size;
+		d->free_list = NULL;
+	}
+}
+
+/* Grows the heap by PAGE_CNT pages and returns the first, or a null
+   pointer if the heap cannot grow. */
+static void *
+get_pages (size_t page_cnt) {
+	uintptr_t brk = (uintptr_t) sbrk (0);
+
+	/* Someone else may have left the break in the middle of a page. */
+	if (brk % PGSIZE != 0
+			&& sbrk (PGSIZE - brk % PGSIZE) == (void *) -1)
+		return NULL;
+	brk = (uintptr_t) sbrk (page_cnt * PGSIZE);
+	return brk != (uintptr_t) -1 ? (void *) brk : NULL;
+}
+
+/* Returns the arena that block B is inside. */
+static struct arena *
+block_to_arena (void *b) {
+	struct arena *a = (struct arena *) ((uintptr_t) b & ~(PGSIZE - 1));
+
+	ASSERT (a->magic == ARENA_MAGIC);
+	ASSERT (a->desc != NULL || (uintptr_t) b % PGSIZE == sizeof *a);
+	return a;
+}
+
+/* Returns a big block of at least SIZE bytes, from the free list if
+   one there fits, or a null pointer if memory is not available. */
+static void *
+big_malloc (size_t size) {
+	size_t page_cnt = DIV_ROUND_UP (size + sizeof (struct arena), PGSIZE);
+	struct arena **ap, *a;
+
+	for (ap = &big_list; *ap != NULL; ap = &(*ap)->next)
+		if ((*ap)->page_cnt >= page_cnt) {
+			a = *ap;
+			*ap = a->next;
+			return a + 1;
+		}
+
+	a = get_pages (page_cnt);
+	if (a == NULL)
+		return NULL;
+	a->magic = ARENA_MAGIC;
+	a->desc = NULL;
+	a->page_cnt = page_cnt;
+	return a + 1;
+}
+
+/* Frees big block arena A. */
+static void
+big_free (struct arena *a) {
+	if ((uint8_t *) a + a->page_cnt * PGSIZE == sbrk (0))
+		sbrk (-(intptr_t) (a->page_cnt * PGSIZE));
+	else {
+		a->next = big_list;
+		big_list = a;
+	}
+}
+
+/* Obtains and returns a new block of at least SIZE bytes.
+   Returns a null pointer if memory is not available. */
+void *
+malloc (size_t size) {
+	struct desc *d;
+	struct block *b;
+
+	/* A null pointer satisfies a request for 0 bytes. */
+	if (size == 0)
+		return NULL;
+
+	if (desc_cnt == 0)
+		malloc_init ();
+
+	/* Find the smallest descriptor that satisfies a SIZE-byte
+	   request. */
+	for (d = descs; d < descs + desc_cnt; d++)
+		if (d->block_size >= size)
+			break;
+	if (d == descs + desc_cnt)
+		return big_malloc (size);
+
+	/* If the free list is empty, create a new arena. */
+	if (d->free_list == NULL) {
+		struct arena *a = get_pages (1);
+		size_t i;
+
+		if (a == NULL)
+			return NULL;
+		a->magic = ARENA_MAGIC;
+		a->desc = d;
+		a->page_cnt = 1;
+		for (i = d->blocks_per_arena; i-- > 0; ) {
+			b = (struct block *) ((uint8_t *) (a + 1) + i * d->block_size);
+			b->next = d->free_list;
+			d->free_list = b;
+		}
+	}
+
+	/* Get a block from free list and return it. */
+	b = d->free_list;
+	d->free_list = b->next;
+	return b;
+}
+
+/* Allocates and return A times B bytes initialized to zeroes.
+   Returns a null pointer if memory is not available. */
+void *
+calloc (size_t a, size_t b) {
+	void *p;
+	size_t size;
+
+	/* Calculate block size and make sure it fits in size_t. */
+	size = a * b;
+	if (b != 0 && size / b != a)
+		return NULL;
+
+	/* Allocate and zero memory. */
+	p = malloc (size);
+	if (p != NULL)
+		memset (p, 0, size);
+
+	return p;
+}
+
+/* Returns the number of bytes allocated for BLOCK. */
+static size_t
+block_size (void *block) {
+	struct arena *a = block_to_arena (block);
+
+	return a->desc != NULL ? a->desc->block_size
+		: a->page_cnt * PGSIZE - sizeof *a;
+}
+
+/* Attempts to resize OLD_BLOCK to NEW_SIZE bytes, possibly
+   moving it in the process.
+   If successful, returns the new block; on failure, returns a
+   null pointer.
+   A call with null OLD_BLOCK is equivalent to malloc(NEW_SIZE).
+   A call with zero NEW_SIZE is equivalent to free(OLD_BLOCK). */
+void *
+realloc (void *old_block, size_t new_size) {
+	if (new_size == 0) {
+		free (old_block);
+		return NULL;
+	} else if (old_block != NULL && new_size <= block_size (old_block))
+		return old_block;
+	else {
+		void *new_block = malloc (new_size);
+		if (old_block != NULL && new_block != NULL) {
+			memcpy (new_block, old_block, block_size (old_block));
+			free (old_block);
+		}
+		return new_block;
+	}
+}
+
+/* Frees block P, which must have been previously allocated with
+   malloc(), calloc(), or realloc(). */
+void
+free (void *p) {
+	if (p != NULL) {
+		struct arena *a = block_to_arena (p);
+		struct desc *d = a->desc;
+
+		if (d != NULL) {
+			struct block *b = p;
+
+#ifndef NDEBUG
+			/* Clear the block to help detect use-after-free bugs. */
+			memset (b, 0xcc, d->block_size);
+#endif
+			b->next = d->free_list;
+			d->free_list = b;
+		} else
+			big_free (a);
+	}
+}
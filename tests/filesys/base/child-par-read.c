@@ -0,0 +1,50 @@
+/* Child process for syn-par-read test.
+   Reads one of the test files a block at a time, several times
+   over, checking each block against the expected contents. */
+
+#include <random.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/filesys/base/syn-par-read.h"
+
+const char *test_name = "child-par-read";
+
+static char buf[2][BUF_SIZE];
+
+int
+main (int argc, const char *argv[]) 
+{
+  static char block[CHUNK_SIZE];
+  const char *name;
+  int child_idx;
+  int fd;
+  int pass;
+  size_t ofs;
+
+  quiet = true;
+
+  CHECK (argc == 2, "argc must be 2, actually %d", argc);
+  child_idx = atoi (argv[1]);
+  name = file_names[child_idx % 2];
+
+  random_init (0);
+  random_bytes (buf, sizeof buf);
+
+  CHECK ((fd = open (name)) > 1, "open \"%s\"", name);
+  for (pass = 0; pass < PASS_CNT; pass++) 
+    {
+      seek (fd, 0);
+      for (ofs = 0; ofs < BUF_SIZE; ofs += CHUNK_SIZE) 
+        {
+          CHECK (read (fd, block, CHUNK_SIZE) == CHUNK_SIZE,
+                 "read \"%s\"", name);
+          compare_bytes (block, buf[child_idx % 2] + ofs, CHUNK_SIZE,
+                         ofs, name);
+        }
+    }
+  close (fd);
+
+  return child_idx;
+}
@@ -0,0 +1,59 @@
+/* Grows the root directory to 10, 1,000 and 10,000 files,
+   opening every file at each size, then removes them all.  With
+   hashed directories, the time per create and open should hardly
+   change from one size to the next. */
+
+#include <stdio.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+static const int sizes[] = {10, 1000, 10000};
+
+static void
+make_name (char *name, size_t size, int i) 
+{
+  snprintf (name, size, "f%d", i);
+}
+
+void
+test_main (void) 
+{
+  char name[16];
+  size_t s;
+  int cnt = 0;
+  int i;
+
+  for (s = 0; s < sizeof sizes / sizeof *sizes; s++)
+    {
+      msg ("create files up to %d", sizes[s]);
+      for (; cnt < sizes[s]; cnt++)
+        {
+          make_name (name, sizeof name, cnt);
+          if (!create (name, 0))
+            fail ("create \"%s\" failed", name);
+        }
+
+      msg ("open %d files", cnt);
+      for (i = 0; i < cnt; i++)
+        {
+          int fd;
+
+          make_name (name, sizeof name, i);
+          fd = open (name);
+          if (fd < 2)
+            fail ("open \"%s\" failed", name);
+          close (fd);
+        }
+    }
+
+  msg ("remove %d files", cnt);
+  for (i = 0; i < cnt; i++)
+    {
+      make_name (name, sizeof name, i);
+      if (!remove (name))
+        fail ("remove \"%s\" failed", name);
+    }
+  make_name (name, sizeof name, 0);
+  CHECK (open (name) == -1, "open \"%s\" after removal", name);
+}
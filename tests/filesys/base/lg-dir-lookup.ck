@@ -0,0 +1,17 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(lg-dir-lookup) begin
+(lg-dir-lookup) create files up to 10
+(lg-dir-lookup) open 10 files
+(lg-dir-lookup) create files up to 1000
+(lg-dir-lookup) open 1000 files
+(lg-dir-lookup) create files up to 10000
+(lg-dir-lookup) open 10000 files
+(lg-dir-lookup) remove 10000 files
+(lg-dir-lookup) open "f0" after removal
+(lg-dir-lookup) end
+EOF
+pass;
@@ -0,0 +1,72 @@
+/* Moves a file's contents in single large reads and writes,
+   which bypass the buffer cache, interleaved with small ones,
+   which go through it, and checks that each kind sees what the
+   other wrote. */
+
+#include <random.h>
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define FILE_SIZE 98304
+#define PATCH_SIZE 100
+#define PATCH_CNT 37
+
+static char buf[FILE_SIZE];
+static char rbuf[FILE_SIZE];
+
+void
+test_main (void) 
+{
+  size_t ofs;
+  int fd;
+  int i;
+
+  random_init (0);
+  random_bytes (buf, sizeof buf);
+
+  CHECK (create ("data", 0), "create \"data\"");
+  CHECK ((fd = open ("data")) > 1, "open \"data\"");
+  CHECK (write (fd, buf, sizeof buf) == sizeof buf,
+         "write \"data\" in one call");
+
+  msg ("patch \"data\" in small writes");
+  for (i = 0; i < PATCH_CNT; i++)
+    {
+      char patch[PATCH_SIZE];
+
+      ofs = (size_t) i * (FILE_SIZE / PATCH_CNT) + i;
+      random_bytes (patch, sizeof patch);
+      memcpy (buf + ofs, patch, sizeof patch);
+      seek (fd, ofs);
+      if (write (fd, patch, sizeof patch) != sizeof patch)
+        fail ("write %d bytes at offset %zu failed", PATCH_SIZE, ofs);
+    }
+
+  seek (fd, 0);
+  CHECK (read (fd, rbuf, sizeof rbuf) == sizeof rbuf,
+         "read \"data\" in one call");
+  compare_bytes (rbuf, buf, sizeof buf, 0, "data");
+
+  random_bytes (buf, sizeof buf);
+  seek (fd, 0);
+  CHECK (write (fd, buf, sizeof buf) == sizeof buf,
+         "rewrite \"data\" in one call");
+
+  msg ("read \"data\" in small reads");
+  seek (fd, 0);
+  for (ofs = 0; ofs < FILE_SIZE; ofs += PATCH_SIZE)
+    {
+      size_t n = FILE_SIZE - ofs < PATCH_SIZE ? FILE_SIZE - ofs : PATCH_SIZE;
+
+      if (read (fd, rbuf + ofs, n) != (int) n)
+        fail ("read %zu bytes at offset %zu failed", n, ofs);
+    }
+  compare_bytes (rbuf, buf, sizeof buf, 0, "data");
+
+  msg ("close \"data\"");
+  close (fd);
+
+  check_file ("data", buf, sizeof buf);
+}
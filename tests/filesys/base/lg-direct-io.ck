@@ -0,0 +1,20 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(lg-direct-io) begin
+(lg-direct-io) create "data"
+(lg-direct-io) open "data"
+(lg-direct-io) write "data" in one call
+(lg-direct-io) patch "data" in small writes
+(lg-direct-io) read "data" in one call
+(lg-direct-io) rewrite "data" in one call
+(lg-direct-io) read "data" in small reads
+(lg-direct-io) close "data"
+(lg-direct-io) open "data" for verification
+(lg-direct-io) verified contents of "data"
+(lg-direct-io) close "data"
+(lg-direct-io) end
+EOF
+pass;
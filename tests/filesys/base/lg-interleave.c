@@ -0,0 +1,50 @@
+/* Grows two files from empty in turn, one sector at a time, so
+   that each file's next sector is always taken by the other.
+   Each file ends up in a hundred separate runs of sectors, more
+   than its inode holds, then both are read back to verify. */
+
+#include <random.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define FILE_SIZE 51200
+#define BLOCK_SIZE 512
+
+static char buf_a[FILE_SIZE];
+static char buf_b[FILE_SIZE];
+
+void
+test_main (void) 
+{
+  size_t ofs;
+  int fd_a, fd_b;
+
+  random_init (0);
+  random_bytes (buf_a, sizeof buf_a);
+  random_bytes (buf_b, sizeof buf_b);
+
+  CHECK (create ("a", 0), "create \"a\"");
+  CHECK (create ("b", 0), "create \"b\"");
+  CHECK ((fd_a = open ("a")) > 1, "open \"a\"");
+  CHECK ((fd_b = open ("b")) > 1, "open \"b\"");
+
+  msg ("write \"a\" and \"b\" in turn");
+  for (ofs = 0; ofs < FILE_SIZE; ofs += BLOCK_SIZE)
+    {
+      if (write (fd_a, buf_a + ofs, BLOCK_SIZE) != BLOCK_SIZE)
+        fail ("write %d bytes at offset %zu in \"a\" failed",
+              BLOCK_SIZE, ofs);
+      if (write (fd_b, buf_b + ofs, BLOCK_SIZE) != BLOCK_SIZE)
+        fail ("write %d bytes at offset %zu in \"b\" failed",
+              BLOCK_SIZE, ofs);
+    }
+
+  msg ("close \"a\"");
+  close (fd_a);
+  msg ("close \"b\"");
+  close (fd_b);
+
+  check_file ("a", buf_a, sizeof buf_a);
+  check_file ("b", buf_b, sizeof buf_b);
+}
@@ -0,0 +1,45 @@
+/* Opens the same existing and missing files over and over, the
+   way a build probes for its inputs, then checks that removing
+   and re-creating a file is seen by the next open. */
+
+#include <stdio.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define FILE_CNT 20
+#define ROUND_CNT 50
+
+void
+test_main (void) 
+{
+  char name[16];
+  int round, i, fd;
+
+  for (i = 0; i < FILE_CNT; i++)
+    {
+      snprintf (name, sizeof name, "file%d", i);
+      CHECK (create (name, 0), "create \"%s\"", name);
+    }
+
+  msg ("open existing and missing files %d times", ROUND_CNT);
+  for (round = 0; round < ROUND_CNT; round++)
+    for (i = 0; i < FILE_CNT; i++)
+      {
+        snprintf (name, sizeof name, "file%d", i);
+        fd = open (name);
+        if (fd < 2)
+          fail ("open \"%s\" failed", name);
+        close (fd);
+
+        snprintf (name, sizeof name, "missing%d", i);
+        if (open (name) != -1)
+          fail ("open \"%s\" succeeded", name);
+      }
+
+  CHECK (remove ("file0"), "remove \"file0\"");
+  CHECK (open ("file0") == -1, "open \"file0\" after removal");
+  CHECK (create ("missing0", 0), "create \"missing0\"");
+  CHECK ((fd = open ("missing0")) > 1, "open \"missing0\" after creation");
+  close (fd);
+}
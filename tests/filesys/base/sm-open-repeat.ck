@@ -0,0 +1,34 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(sm-open-repeat) begin
+(sm-open-repeat) create "file0"
+(sm-open-repeat) create "file1"
+(sm-open-repeat) create "file2"
+(sm-open-repeat) create "file3"
+(sm-open-repeat) create "file4"
+(sm-open-repeat) create "file5"
+(sm-open-repeat) create "file6"
+(sm-open-repeat) create "file7"
+(sm-open-repeat) create "file8"
+(sm-open-repeat) create "file9"
+(sm-open-repeat) create "file10"
+(sm-open-repeat) create "file11"
+(sm-open-repeat) create "file12"
+(sm-open-repeat) create "file13"
+(sm-open-repeat) create "file14"
+(sm-open-repeat) create "file15"
+(sm-open-repeat) create "file16"
+(sm-open-repeat) create "file17"
+(sm-open-repeat) create "file18"
+(sm-open-repeat) create "file19"
+(sm-open-repeat) open existing and missing files 50 times
+(sm-open-repeat) remove "file0"
+(sm-open-repeat) open "file0" after removal
+(sm-open-repeat) create "missing0"
+(sm-open-repeat) open "missing0" after creation
+(sm-open-repeat) end
+EOF
+pass;
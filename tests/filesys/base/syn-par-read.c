@@ -0,0 +1,42 @@
+/* Spawns 6 child processes that read two files in parallel, half
+   of them each file, and make sure that the contents are what
+   they should be.  Readers of the same file share its inode, so
+   this exercises concurrent readers under one inode lock as well
+   as readers of different inodes.  The timer ticks printed at
+   power off, set against those of a kernel that serializes file
+   I/O behind one lock, give the throughput gain. */
+
+#include <random.h>
+#include <stdio.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+#include "tests/filesys/base/syn-par-read.h"
+
+static char buf[2][BUF_SIZE];
+
+#define CHILD_CNT 6
+
+void
+test_main (void) 
+{
+  pid_t children[CHILD_CNT];
+  int fd;
+  int i;
+
+  random_bytes (buf, sizeof buf);
+  for (i = 0; i < 2; i++) 
+    {
+      const char *name = file_names[i];
+
+      CHECK (create (name, BUF_SIZE), "create \"%s\"", name);
+      CHECK ((fd = open (name)) > 1, "open \"%s\"", name);
+      CHECK (write (fd, buf[i], BUF_SIZE) == BUF_SIZE,
+             "write \"%s\"", name);
+      msg ("close \"%s\"", name);
+      close (fd);
+    }
+
+  exec_children ("child-par-read", children, CHILD_CNT);
+  wait_children (children, CHILD_CNT);
+}
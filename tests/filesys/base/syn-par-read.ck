@@ -0,0 +1,29 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(syn-par-read) begin
+(syn-par-read) create "data-a"
+(syn-par-read) open "data-a"
+(syn-par-read) write "data-a"
+(syn-par-read) close "data-a"
+(syn-par-read) create "data-b"
+(syn-par-read) open "data-b"
+(syn-par-read) write "data-b"
+(syn-par-read) close "data-b"
+(syn-par-read) exec child 1 of 6: "child-par-read 0"
+(syn-par-read) exec child 2 of 6: "child-par-read 1"
+(syn-par-read) exec child 3 of 6: "child-par-read 2"
+(syn-par-read) exec child 4 of 6: "child-par-read 3"
+(syn-par-read) exec child 5 of 6: "child-par-read 4"
+(syn-par-read) exec child 6 of 6: "child-par-read 5"
+(syn-par-read) wait for child 1 of 6 returned 0 (expected 0)
+(syn-par-read) wait for child 2 of 6 returned 1 (expected 1)
+(syn-par-read) wait for child 3 of 6 returned 2 (expected 2)
+(syn-par-read) wait for child 4 of 6 returned 3 (expected 3)
+(syn-par-read) wait for child 5 of 6 returned 4 (expected 4)
+(syn-par-read) wait for child 6 of 6 returned 5 (expected 5)
+(syn-par-read) end
+EOF
+pass;
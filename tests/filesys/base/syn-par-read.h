@@ -0,0 +1,9 @@
+#ifndef TESTS_FILESYS_BASE_SYN_PAR_READ_H
+#define TESTS_FILESYS_BASE_SYN_PAR_READ_H
+
+#define BUF_SIZE 32768
+#define CHUNK_SIZE 512
+#define PASS_CNT 4
+static const char *file_names[2] = {"data-a", "data-b"};
+
+#endif /* tests/filesys/base/syn-par-read.h */
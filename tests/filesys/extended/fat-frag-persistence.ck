@@ -0,0 +1,10 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+use tests::random;
+my ($fs);
+$fs->{"small$_"} = ["\0" x 8192] foreach (1, 3, 5, 7, 9, 11);
+$fs->{"big"} = [random_bytes (128 * 1024)];
+check_archive ($fs);
+pass;
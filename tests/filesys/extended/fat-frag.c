@@ -0,0 +1,72 @@
+/* Fragments the disk by creating a dozen small files and removing
+   every other one, then writes a large file into the holes and
+   reads it back sequentially and in random order.  The kernel's
+   disk statistics at power off show how the allocator and the
+   file's index blocks cope with a fragmented file. */
+
+#include <random.h>
+#include <stdio.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define SMALL_CNT 12
+#define SMALL_SIZE 8192
+#define BIG_SIZE (128 * 1024)
+#define BLOCK_SIZE 512
+#define RANDOM_CNT 512
+
+static char buf[BIG_SIZE];
+static char block[BLOCK_SIZE];
+
+void
+test_main (void) 
+{
+  char name[16];
+  size_t ofs;
+  int fd;
+  int i;
+
+  random_init (0);
+  random_bytes (buf, sizeof buf);
+
+  for (i = 0; i < SMALL_CNT; i++)
+    {
+      snprintf (name, sizeof name, "small%d", i);
+      CHECK (create (name, SMALL_SIZE), "create \"%s\"", name);
+    }
+  for (i = 0; i < SMALL_CNT; i += 2)
+    {
+      snprintf (name, sizeof name, "small%d", i);
+      CHECK (remove (name), "remove \"%s\"", name);
+    }
+
+  CHECK (create ("big", sizeof buf), "create \"big\"");
+  CHECK ((fd = open ("big")) > 1, "open \"big\"");
+  msg ("write \"big\" sequentially");
+  for (ofs = 0; ofs < sizeof buf; ofs += BLOCK_SIZE)
+    if (write (fd, buf + ofs, BLOCK_SIZE) != BLOCK_SIZE)
+      fail ("write %d bytes at offset %zu failed", BLOCK_SIZE, ofs);
+
+  msg ("read \"big\" sequentially");
+  seek (fd, 0);
+  for (ofs = 0; ofs < sizeof buf; ofs += BLOCK_SIZE)
+    {
+      if (read (fd, block, BLOCK_SIZE) != BLOCK_SIZE)
+        fail ("read %d bytes at offset %zu failed", BLOCK_SIZE, ofs);
+      compare_bytes (block, buf + ofs, BLOCK_SIZE, ofs, "big");
+    }
+
+  msg ("read \"big\" in random order");
+  for (i = 0; i < RANDOM_CNT; i++)
+    {
+      ofs = random_ulong () % (sizeof buf / BLOCK_SIZE) * BLOCK_SIZE;
+      seek (fd, ofs);
+      if (read (fd, block, BLOCK_SIZE) != BLOCK_SIZE)
+        fail ("read %d bytes at offset %zu failed", BLOCK_SIZE, ofs);
+      compare_bytes (block, buf + ofs, BLOCK_SIZE, ofs, "big");
+    }
+
+  msg ("close \"big\"");
+  close (fd);
+}
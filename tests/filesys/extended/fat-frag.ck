@@ -0,0 +1,33 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(fat-frag) begin
+(fat-frag) create "small0"
+(fat-frag) create "small1"
+(fat-frag) create "small2"
+(fat-frag) create "small3"
+(fat-frag) create "small4"
+(fat-frag) create "small5"
+(fat-frag) create "small6"
+(fat-frag) create "small7"
+(fat-frag) create "small8"
+(fat-frag) create "small9"
+(fat-frag) create "small10"
+(fat-frag) create "small11"
+(fat-frag) remove "small0"
+(fat-frag) remove "small2"
+(fat-frag) remove "small4"
+(fat-frag) remove "small6"
+(fat-frag) remove "small8"
+(fat-frag) remove "small10"
+(fat-frag) create "big"
+(fat-frag) open "big"
+(fat-frag) write "big" sequentially
+(fat-frag) read "big" sequentially
+(fat-frag) read "big" in random order
+(fat-frag) close "big"
+(fat-frag) end
+EOF
+pass;
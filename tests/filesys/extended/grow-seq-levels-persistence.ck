@@ -0,0 +1,11 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+use tests::random;
+my ($direct) = random_bytes (30000);
+my ($indirect) = random_bytes (100000);
+my ($doubly) = random_bytes (400000);
+check_archive ({"direct" => [$direct], "indirect" => [$indirect],
+		"doubly" => [$doubly]});
+pass;
@@ -0,0 +1,22 @@
+/* Grows three files sequentially, 4 kB at a time, to sizes that
+   end in the inode's direct, indirect and doubly indirect
+   sectors, reading each back to verify. */
+
+#include "tests/filesys/seq-test.h"
+#include "tests/main.h"
+
+static char buf[400000];
+
+static size_t
+return_block_size (void) 
+{
+  return 4096;
+}
+
+void
+test_main (void) 
+{
+  seq_test ("direct", buf, 30000, 0, return_block_size, NULL);
+  seq_test ("indirect", buf, 100000, 0, return_block_size, NULL);
+  seq_test ("doubly", buf, sizeof buf, 0, return_block_size, NULL);
+}
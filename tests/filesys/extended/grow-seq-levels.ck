@@ -0,0 +1,30 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(grow-seq-levels) begin
+(grow-seq-levels) create "direct"
+(grow-seq-levels) open "direct"
+(grow-seq-levels) writing "direct"
+(grow-seq-levels) close "direct"
+(grow-seq-levels) open "direct" for verification
+(grow-seq-levels) verified contents of "direct"
+(grow-seq-levels) close "direct"
+(grow-seq-levels) create "indirect"
+(grow-seq-levels) open "indirect"
+(grow-seq-levels) writing "indirect"
+(grow-seq-levels) close "indirect"
+(grow-seq-levels) open "indirect" for verification
+(grow-seq-levels) verified contents of "indirect"
+(grow-seq-levels) close "indirect"
+(grow-seq-levels) create "doubly"
+(grow-seq-levels) open "doubly"
+(grow-seq-levels) writing "doubly"
+(grow-seq-levels) close "doubly"
+(grow-seq-levels) open "doubly" for verification
+(grow-seq-levels) verified contents of "doubly"
+(grow-seq-levels) close "doubly"
+(grow-seq-levels) end
+EOF
+pass;
@@ -0,0 +1,47 @@
+/* Seeks past the part of an empty file that the inode's doubly
+   indirect block can reach and writes there.  Checks that the
+   data reads back and that the hole before it reads as zeros,
+   then removes the file, which is too large to archive. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+/* Past the 8,517,120 bytes that direct, indirect and doubly
+   indirect sectors cover. */
+#define FAR_OFS (12 * 1024 * 1024)
+
+static char buf[512];
+static char expected[1024];
+static char actual[1024];
+
+void
+test_main (void) 
+{
+  const char *file_name = "testfile";
+  size_t i;
+  int fd;
+
+  for (i = 0; i < sizeof buf; i++)
+    buf[i] = i % 251 + 1;
+  memcpy (expected + sizeof buf, buf, sizeof buf);
+
+  CHECK (create (file_name, 0), "create \"%s\"", file_name);
+  CHECK ((fd = open (file_name)) > 1, "open \"%s\"", file_name);
+  msg ("seek \"%s\"", file_name);
+  seek (fd, FAR_OFS);
+  CHECK (write (fd, buf, sizeof buf) == sizeof buf,
+         "write \"%s\"", file_name);
+  CHECK (filesize (fd) == FAR_OFS + sizeof buf,
+         "filesize \"%s\"", file_name);
+  msg ("seek \"%s\"", file_name);
+  seek (fd, FAR_OFS - sizeof buf);
+  CHECK (read (fd, actual, sizeof actual) == sizeof actual,
+         "read \"%s\"", file_name);
+  compare_bytes (actual, expected, sizeof actual, FAR_OFS - sizeof buf,
+                 file_name);
+  msg ("close \"%s\"", file_name);
+  close (fd);
+  CHECK (remove (file_name), "remove \"%s\"", file_name);
+}
@@ -0,0 +1,18 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(grow-sparse-far) begin
+(grow-sparse-far) create "testfile"
+(grow-sparse-far) open "testfile"
+(grow-sparse-far) seek "testfile"
+(grow-sparse-far) write "testfile"
+(grow-sparse-far) filesize "testfile"
+(grow-sparse-far) seek "testfile"
+(grow-sparse-far) read "testfile"
+(grow-sparse-far) close "testfile"
+(grow-sparse-far) remove "testfile"
+(grow-sparse-far) end
+EOF
+pass;
@@ -0,0 +1,18 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(huge-stride-off) begin
+(huge-stride-off) touch 65536 pages
+(huge-stride-off) stride pass 0
+(huge-stride-off) stride pass 1
+(huge-stride-off) stride pass 2
+(huge-stride-off) stride pass 3
+(huge-stride-off) stride pass 4
+(huge-stride-off) stride pass 5
+(huge-stride-off) stride pass 6
+(huge-stride-off) stride pass 7
+(huge-stride-off) end
+EOF
+pass;
@@ -0,0 +1,34 @@
+/* Touches every page of a 256 MiB array, then reads it back
+   several times with a 4 KiB stride, so that nearly every access
+   needs a TLB entry of its own.  Run as huge-stride with huge
+   pages and as huge-stride-off with the -nohuge kernel option, and
+   compare the run times and the "Huge pages" statistics. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define SIZE (256 * 1024 * 1024)
+#define STRIDE 4096
+#define PASSES 8
+
+static char buf[SIZE];
+
+void
+test_main (void)
+{
+  size_t i;
+  int pass;
+
+  msg ("touch %d pages", SIZE / STRIDE);
+  for (i = 0; i < SIZE; i += STRIDE)
+    buf[i] = i / STRIDE;
+
+  for (pass = 0; pass < PASSES; pass++)
+    {
+      msg ("stride pass %d", pass);
+      for (i = 0; i < SIZE; i += STRIDE)
+        if (buf[i] != (char) (i / STRIDE))
+          fail ("byte %zu is %d, expected %d", i, buf[i], (char) (i / STRIDE));
+    }
+}
@@ -0,0 +1,18 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(huge-stride) begin
+(huge-stride) touch 65536 pages
+(huge-stride) stride pass 0
+(huge-stride) stride pass 1
+(huge-stride) stride pass 2
+(huge-stride) stride pass 3
+(huge-stride) stride pass 4
+(huge-stride) stride pass 5
+(huge-stride) stride pass 6
+(huge-stride) stride pass 7
+(huge-stride) end
+EOF
+pass;
@@ -0,0 +1,58 @@
+/* Same-page merging.  Forks CHILD_CNT children that each fill a table
+   with the same contents and then keep reading it back for a while,
+   long enough for the ksm thread to find the identical pages and merge
+   them.  The kernel reports the pages merged and the memory saved at
+   power off. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define CHILD_CNT 4
+#define PAGE_SIZE 4096
+#define TABLE_PAGES 256
+#define TABLE_SIZE (TABLE_PAGES * PAGE_SIZE)
+#define PASS_CNT 400
+
+static unsigned char table[TABLE_SIZE];
+
+/* Fills TABLE, checks it PASS_CNT times and returns the number of
+   bytes that were wrong. */
+static int
+child (void)
+{
+  size_t i;
+  int pass, bad = 0;
+
+  for (i = 0; i < TABLE_SIZE; i++)
+    table[i] = (unsigned char) (i * 7 + i / PAGE_SIZE);
+
+  for (pass = 0; pass < PASS_CNT; pass++)
+    for (i = 0; i < TABLE_SIZE; i += 64)
+      if (table[i] != (unsigned char) (i * 7 + i / PAGE_SIZE))
+        bad++;
+
+  /* Write to half of the pages again, which must unshare them. */
+  for (i = 0; i < TABLE_SIZE; i += 2 * PAGE_SIZE)
+    table[i] ^= 0xff;
+  for (i = 0; i < TABLE_SIZE; i += PAGE_SIZE)
+    if (table[i] != (unsigned char) ((i * 7 + i / PAGE_SIZE)
+                                     ^ (i % (2 * PAGE_SIZE) ? 0 : 0xff)))
+      bad++;
+  return bad;
+}
+
+void
+test_main (void)
+{
+  pid_t children[CHILD_CNT];
+  int i;
+
+  for (i = 0; i < CHILD_CNT; i++) {
+    children[i] = fork ("child");
+    if (children[i] == 0)
+      exit (child ());
+  }
+  for (i = 0; i < CHILD_CNT; i++)
+    CHECK (wait (children[i]) == 0, "wait for child %d", i);
+}
@@ -0,0 +1,13 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(ksm-merge) begin
+(ksm-merge) wait for child 0
+(ksm-merge) wait for child 1
+(ksm-merge) wait for child 2
+(ksm-merge) wait for child 3
+(ksm-merge) end
+EOF
+pass;
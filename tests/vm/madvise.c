@@ -0,0 +1,62 @@
+/* Exercises madvise(): prefetches a file mapping with MADV_WILLNEED,
+   drops it with MADV_DONTNEED after writing to it and checks that the
+   data reached the file, drops a written anonymous region and checks
+   that it reads back as zeros, and checks that bad arguments are
+   rejected. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/vm/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE_SIZE 4096
+#define ANON_PAGES 8
+#define ACTUAL ((void *) 0x10000000)
+
+static char anon[ANON_PAGES * PAGE_SIZE] __attribute__ ((aligned (PAGE_SIZE)));
+
+void
+test_main (void)
+{
+  size_t len = strlen (sample);
+  char buf[16];
+  int handle, handle2;
+  char *map;
+  size_t i;
+
+  CHECK ((handle = open ("sample.txt")) > 1, "open \"sample.txt\"");
+  CHECK ((map = mmap (ACTUAL, PAGE_SIZE, 1, handle, 0)) != MAP_FAILED,
+         "mmap \"sample.txt\"");
+  CHECK (madvise (map, PAGE_SIZE, MADV_SEQUENTIAL) == 0, "madvise SEQUENTIAL");
+  CHECK (madvise (map, PAGE_SIZE, MADV_WILLNEED) == 0, "madvise WILLNEED");
+  if (memcmp (map, sample, len))
+    fail ("read of prefetched mapping reported bad data");
+
+  memcpy (map, "madvise", 7);
+  CHECK (madvise (map, PAGE_SIZE, MADV_DONTNEED) == 0, "madvise DONTNEED");
+  if (memcmp (map, "madvise", 7) || memcmp (map + 7, sample + 7, len - 7))
+    fail ("mapping lost data after MADV_DONTNEED");
+  CHECK ((handle2 = open ("sample.txt")) > 1, "open \"sample.txt\" again");
+  CHECK (read (handle2, buf, 7) == 7, "read \"sample.txt\"");
+  if (memcmp (buf, "madvise", 7))
+    fail ("MADV_DONTNEED did not write back the mapping");
+  close (handle2);
+  munmap (map);
+  close (handle);
+
+  memset (anon, 0x5a, sizeof anon);
+  CHECK (madvise (anon, sizeof anon, MADV_DONTNEED) == 0,
+         "madvise DONTNEED on anonymous memory");
+  for (i = 0; i < sizeof anon; i++)
+    if (anon[i] != 0)
+      fail ("byte %zu is %02hhx after MADV_DONTNEED (should be 0)",
+            i, anon[i]);
+
+  CHECK (madvise (anon, sizeof anon, MADV_RANDOM) == 0, "madvise RANDOM");
+  CHECK (madvise (anon, sizeof anon, 99) == -1, "madvise bad advice");
+  CHECK (madvise (anon + 1, PAGE_SIZE, MADV_NORMAL) == -1,
+         "madvise misaligned address");
+  CHECK (madvise (ACTUAL, PAGE_SIZE, MADV_NORMAL) == -1,
+         "madvise unmapped address");
+}
@@ -0,0 +1,21 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(madvise) begin
+(madvise) open "sample.txt"
+(madvise) mmap "sample.txt"
+(madvise) madvise SEQUENTIAL
+(madvise) madvise WILLNEED
+(madvise) madvise DONTNEED
+(madvise) open "sample.txt" again
+(madvise) read "sample.txt"
+(madvise) madvise DONTNEED on anonymous memory
+(madvise) madvise RANDOM
+(madvise) madvise bad advice
+(madvise) madvise misaligned address
+(madvise) madvise unmapped address
+(madvise) end
+EOF
+pass;
@@ -0,0 +1,102 @@
+/* Allocation benchmark: keeps a few hundred blocks of random sizes,
+   from a few bytes to several pages, live at once and repeatedly frees
+   and reallocates them, some with realloc().  Each block is filled
+   with a byte of its own, which is checked before the block is
+   freed. */
+
+#include <malloc.h>
+#include <string.h>
+#include <syscall.h>
+#include "tests/arc4.h"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define SLOT_CNT 512
+#define ROUND_CNT 40000
+
+struct slot
+  {
+    unsigned char *p;
+    size_t size;
+    unsigned char fill;
+  };
+
+static struct slot slots[SLOT_CNT];
+
+static uint32_t
+random32 (struct arc4 *arc4)
+{
+  uint32_t v;
+
+  arc4_crypt (arc4, &v, sizeof v);
+  return v;
+}
+
+/* Most blocks are small, a few are big. */
+static size_t
+random_size (struct arc4 *arc4)
+{
+  uint32_t r = random32 (arc4);
+
+  if (r % 16 == 0)
+    return 1 + r / 16 % (5 * 4096);
+  return 1 + r / 16 % 512;
+}
+
+static void
+check_slot (struct slot *s, size_t idx)
+{
+  size_t i;
+
+  for (i = 0; i < s->size; i++)
+    if (s->p[i] != s->fill)
+      fail ("block in slot %zu corrupted at byte %zu of %zu",
+            idx, i, s->size);
+}
+
+void
+test_main (void)
+{
+  struct arc4 arc4;
+  size_t round, i;
+
+  arc4_init (&arc4, "malloc-churn", 12);
+  for (round = 0; round < ROUND_CNT; round++)
+    {
+      size_t idx = random32 (&arc4) % SLOT_CNT;
+      struct slot *s = &slots[idx];
+      size_t size = random_size (&arc4);
+
+      if (s->p != NULL)
+        {
+          check_slot (s, idx);
+          if (round % 4 == 0)
+            {
+              /* Grow or shrink in place of a free/malloc pair. */
+              s->p = realloc (s->p, size);
+              if (s->p == NULL)
+                fail ("realloc of %zu bytes failed", size);
+              if (size > s->size)
+                memset (s->p + s->size, s->fill, size - s->size);
+              s->size = size;
+              continue;
+            }
+          free (s->p);
+        }
+      s->p = malloc (size);
+      if (s->p == NULL)
+        fail ("malloc of %zu bytes failed", size);
+      s->size = size;
+      s->fill = (unsigned char) round;
+      memset (s->p, s->fill, size);
+    }
+  msg ("%d rounds done", ROUND_CNT);
+
+  for (i = 0; i < SLOT_CNT; i++)
+    if (slots[i].p != NULL)
+      {
+        check_slot (&slots[i], i);
+        free (slots[i].p);
+      }
+  msg ("all blocks intact");
+}
@@ -0,0 +1,11 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(malloc-churn) begin
+(malloc-churn) 40000 rounds done
+(malloc-churn) all blocks intact
+(malloc-churn) end
+EOF
+pass;
@@ -0,0 +1,94 @@
+/* Allocation benchmark: builds a linked list of random keys one
+   malloc()'d node at a time, copies it into a calloc()'d array grown
+   with realloc(), and merge sorts the array with a freshly malloc()'d
+   scratch buffer at every level of the recursion. */
+
+#include <malloc.h>
+#include <string.h>
+#include <syscall.h>
+#include "tests/arc4.h"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define KEY_CNT (128 * 1024)
+
+struct node
+  {
+    struct node *next;
+    uint32_t key;
+  };
+
+static void
+merge_sort (uint32_t *a, size_t n)
+{
+  uint32_t *tmp;
+  size_t mid = n / 2, i = 0, j = mid, k = 0;
+
+  if (n < 2)
+    return;
+  merge_sort (a, mid);
+  merge_sort (a + mid, n - mid);
+
+  tmp = malloc (n * sizeof *tmp);
+  if (tmp == NULL)
+    fail ("malloc of %zu keys failed", n);
+  while (i < mid && j < n)
+    tmp[k++] = a[i] <= a[j] ? a[i++] : a[j++];
+  while (i < mid)
+    tmp[k++] = a[i++];
+  while (j < n)
+    tmp[k++] = a[j++];
+  memcpy (a, tmp, n * sizeof *a);
+  free (tmp);
+}
+
+void
+test_main (void)
+{
+  struct arc4 arc4;
+  struct node *list = NULL, *e;
+  uint32_t *keys, sum = 0, sorted_sum = 0;
+  size_t cap = 16, cnt = 0, i;
+
+  arc4_init (&arc4, "malloc-sort", 11);
+  for (i = 0; i < KEY_CNT; i++)
+    {
+      e = malloc (sizeof *e);
+      if (e == NULL)
+        fail ("malloc of node %zu failed", i);
+      arc4_crypt (&arc4, &e->key, sizeof e->key);
+      sum += e->key;
+      e->next = list;
+      list = e;
+    }
+  msg ("built list");
+
+  keys = calloc (cap, sizeof *keys);
+  if (keys == NULL)
+    fail ("calloc failed");
+  while (list != NULL)
+    {
+      if (cnt == cap)
+        {
+          cap *= 2;
+          keys = realloc (keys, cap * sizeof *keys);
+          if (keys == NULL)
+            fail ("realloc to %zu keys failed", cap);
+        }
+      keys[cnt++] = list->key;
+      e = list->next;
+      free (list);
+      list = e;
+    }
+  msg ("copied list");
+
+  merge_sort (keys, cnt);
+  for (i = 0; i < cnt; i++)
+    {
+      if (i > 0 && keys[i - 1] > keys[i])
+        fail ("keys %zu and %zu out of order", i - 1, i);
+      sorted_sum += keys[i];
+    }
+  CHECK (cnt == KEY_CNT && sorted_sum == sum, "sorted %zu keys", cnt);
+  free (keys);
+}
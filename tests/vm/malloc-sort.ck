@@ -0,0 +1,12 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(malloc-sort) begin
+(malloc-sort) built list
+(malloc-sort) copied list
+(malloc-sort) sorted 131072 keys
+(malloc-sort) end
+EOF
+pass;
@@ -0,0 +1,57 @@
+/* Locks a small region with mlock(), then sweeps a region larger than
+   the user pool so that everything else is swapped out, and checks
+   that every locked page is still mapped to the frame it had before
+   the sweep, so was never evicted, and kept its contents.  Also checks
+   that bad ranges are rejected. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE_SIZE 4096
+#define LOCKED_SIZE (16 * PAGE_SIZE)
+#define BIG_SIZE (6 * 1024 * 1024)
+#define LOCKED_PAGES (LOCKED_SIZE / PAGE_SIZE)
+
+static char locked[LOCKED_SIZE] __attribute__ ((aligned (PAGE_SIZE)));
+static char big[BIG_SIZE];
+
+void
+test_main (void)
+{
+  void *frames[LOCKED_PAGES];
+  size_t i;
+  int pass;
+
+  for (i = 0; i < LOCKED_SIZE; i++)
+    locked[i] = (char) (i * 3);
+  CHECK (mlock (locked, LOCKED_SIZE) == 0, "mlock");
+  for (i = 0; i < LOCKED_PAGES; i++)
+    if ((frames[i] = get_phys_addr (locked + i * PAGE_SIZE)) == NULL)
+      fail ("locked page %zu is not mapped", i);
+
+  for (pass = 0; pass < 2; pass++)
+    for (i = 0; i < BIG_SIZE; i += PAGE_SIZE)
+      big[i] = (char) (i / PAGE_SIZE + pass);
+  msg ("sweep done");
+
+  /* Before touching the locked pages, which would fault an evicted
+     page back in. */
+  for (i = 0; i < LOCKED_PAGES; i++)
+    if (get_phys_addr (locked + i * PAGE_SIZE) != frames[i])
+      fail ("locked page %zu was evicted", i);
+  msg ("locked pages stayed in their frames");
+
+  for (i = 0; i < LOCKED_SIZE; i++)
+    if (locked[i] != (char) (i * 3))
+      fail ("locked byte %zu is wrong", i);
+  for (i = 0; i < BIG_SIZE; i += PAGE_SIZE)
+    if (big[i] != (char) (i / PAGE_SIZE + 1))
+      fail ("data is inconsistent in page %zu", i / PAGE_SIZE);
+
+  CHECK (munlock (locked, LOCKED_SIZE) == 0, "munlock");
+  CHECK (mlock (locked + 1, PAGE_SIZE) == -1, "mlock misaligned address");
+  CHECK (mlock ((void *) 0x10000000, PAGE_SIZE) == -1,
+         "mlock unmapped address");
+}
@@ -0,0 +1,15 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(mlock) begin
+(mlock) mlock
+(mlock) sweep done
+(mlock) locked pages stayed in their frames
+(mlock) munlock
+(mlock) mlock misaligned address
+(mlock) mlock unmapped address
+(mlock) end
+EOF
+pass;
@@ -0,0 +1,66 @@
+/* Maps anonymous memory with mmap() and FD -1, checks that it reads as
+   zeros and holds what is written to it, that a forked child sees a
+   copy of it, and that it reads as zeros again once unmapped and
+   mapped anew. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE_SIZE 4096
+#define MAP_SIZE (64 * PAGE_SIZE)
+
+static void
+check_zero (const char *p)
+{
+  size_t i;
+
+  for (i = 0; i < MAP_SIZE; i++)
+    if (p[i] != 0)
+      fail ("byte %zu is %d, not zero", i, p[i]);
+}
+
+void
+test_main (void)
+{
+  char *p = (char *) 0x10000000;
+  pid_t child;
+  size_t i;
+
+  CHECK (mmap (p, MAP_SIZE, 1, MAP_ANON, 0) == p, "mmap anonymous");
+  CHECK (get_phys_addr (p) == 0, "check that the mapping is lazy");
+  check_zero (p);
+  msg ("mapping reads as zeros");
+
+  for (i = 0; i < MAP_SIZE; i++)
+    p[i] = (char) (i % 251);
+
+  child = fork ("child");
+  if (child == 0)
+    {
+      for (i = 0; i < MAP_SIZE; i++)
+        if (p[i] != (char) (i % 251))
+          fail ("child sees byte %zu wrong", i);
+      memset (p, 0, MAP_SIZE);
+      exit (81);
+    }
+  quiet = true;
+  CHECK (wait (child) == 81, "wait for child");
+  quiet = false;
+  for (i = 0; i < MAP_SIZE; i++)
+    if (p[i] != (char) (i % 251))
+      fail ("byte %zu is wrong after the child exited", i);
+  msg ("mapping holds its data");
+
+  munmap (p);
+  CHECK (mmap (p, MAP_SIZE, 1, MAP_ANON, 0) == p, "mmap anonymous again");
+  check_zero (p);
+  msg ("new mapping reads as zeros");
+
+  CHECK (mmap (p + PAGE_SIZE, PAGE_SIZE, 1, MAP_ANON, 0) == MAP_FAILED,
+         "overlapping mmap fails");
+  CHECK (mmap (p + MAP_SIZE + 1, PAGE_SIZE, 1, MAP_ANON, 0) == MAP_FAILED,
+         "misaligned mmap fails");
+  munmap (p);
+}
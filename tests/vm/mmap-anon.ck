@@ -0,0 +1,17 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(mmap-anon) begin
+(mmap-anon) mmap anonymous
+(mmap-anon) check that the mapping is lazy
+(mmap-anon) mapping reads as zeros
+(mmap-anon) mapping holds its data
+(mmap-anon) mmap anonymous again
+(mmap-anon) new mapping reads as zeros
+(mmap-anon) overlapping mmap fails
+(mmap-anon) misaligned mmap fails
+(mmap-anon) end
+EOF
+pass;
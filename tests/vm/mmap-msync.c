@@ -0,0 +1,48 @@
+/* Writes to a file through a mapping and flushes it with msync,
+   then checks through a second file descriptor that the data
+   reached the file while the mapping is still in place.  Then
+   dirties both pages with new data, flushes only the second, and
+   checks that the file still holds the old data in the first. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/vm/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define ACTUAL ((void *) 0x10000000)
+
+void
+test_main (void)
+{
+  size_t len = strlen (sample);
+  int handle, handle2;
+  char *map;
+  char buf[1024];
+
+  CHECK (create ("sample.txt", 2 * 4096), "create \"sample.txt\"");
+  CHECK ((handle = open ("sample.txt")) > 1, "open \"sample.txt\"");
+  CHECK ((map = mmap (ACTUAL, 2 * 4096, 1, handle, 0)) != MAP_FAILED,
+         "mmap \"sample.txt\"");
+  memcpy (map, sample, len);
+  CHECK (msync (map, 2 * 4096) == 0, "msync \"sample.txt\"");
+
+  CHECK ((handle2 = open ("sample.txt")) > 1, "open \"sample.txt\" again");
+  read (handle2, buf, len);
+  CHECK (!memcmp (buf, sample, len), "compare first page against written data");
+
+  memset (map, 'x', len);
+  memcpy (map + 4096, sample, len);
+  CHECK (msync (map + 4096, 4096) == 0, "msync second page");
+  seek (handle2, 4096);
+  read (handle2, buf, len);
+  CHECK (!memcmp (buf, sample, len), "compare second page against written data");
+  seek (handle2, 0);
+  read (handle2, buf, len);
+  CHECK (!memcmp (buf, sample, len),
+         "compare first page against data before msync");
+
+  munmap (map);
+  close (handle2);
+  close (handle);
+}
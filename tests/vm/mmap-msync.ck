@@ -0,0 +1,18 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(mmap-msync) begin
+(mmap-msync) create "sample.txt"
+(mmap-msync) open "sample.txt"
+(mmap-msync) mmap "sample.txt"
+(mmap-msync) msync "sample.txt"
+(mmap-msync) open "sample.txt" again
+(mmap-msync) compare first page against written data
+(mmap-msync) msync second page
+(mmap-msync) compare second page against written data
+(mmap-msync) compare first page against data before msync
+(mmap-msync) end
+EOF
+pass;
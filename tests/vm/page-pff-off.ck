@@ -0,0 +1,13 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(page-pff-off) begin
+(page-pff-off) wait for child 0
+(page-pff-off) wait for child 1
+(page-pff-off) wait for child 2
+(page-pff-off) wait for child 3
+(page-pff-off) end
+EOF
+pass;
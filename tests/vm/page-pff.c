@@ -0,0 +1,72 @@
+/* Page-fault-frequency benchmark.  Forks one child that sweeps a
+   region larger than the user pool over and over, so that it faults
+   all the time, and SMALL_CNT children that each keep working on a
+   small table.  With page-fault-frequency allocation the thrashing
+   child should replace its own pages instead of the small children's,
+   so that they finish with few faults.  The kernel reports the total
+   number of faults at power off; page-pff-off runs the same workload
+   with the global clock alone. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define SMALL_CNT 3
+#define PAGE_SIZE 4096
+#define BIG_SIZE (6 * 1024 * 1024)
+#define BIG_PASSES 3
+#define SMALL_SIZE (64 * PAGE_SIZE)
+#define SMALL_PASSES 2000
+
+static char big[BIG_SIZE];
+static char small[SMALL_SIZE];
+
+/* Sweeps BIG and returns the number of bytes that were wrong. */
+static int
+thrash (void)
+{
+  size_t i;
+  int pass, bad = 0;
+
+  for (pass = 0; pass < BIG_PASSES; pass++)
+    for (i = 0; i < BIG_SIZE; i += PAGE_SIZE) {
+      if (pass > 0 && big[i] != (char) (i / PAGE_SIZE + pass - 1))
+        bad++;
+      big[i] = (char) (i / PAGE_SIZE + pass);
+    }
+  return bad;
+}
+
+/* Works on SMALL and returns the number of bytes that were wrong. */
+static int
+work (int id)
+{
+  size_t i;
+  int pass, bad = 0;
+
+  for (pass = 0; pass < SMALL_PASSES; pass++)
+    for (i = 0; i < SMALL_SIZE; i += PAGE_SIZE) {
+      if (pass > 0 && small[i] != (char) (id + pass - 1))
+        bad++;
+      small[i] = (char) (id + pass);
+    }
+  return bad;
+}
+
+void
+test_main (void)
+{
+  pid_t children[SMALL_CNT + 1];
+  int i;
+
+  children[0] = fork ("thrash");
+  if (children[0] == 0)
+    exit (thrash ());
+  for (i = 1; i <= SMALL_CNT; i++) {
+    children[i] = fork ("work");
+    if (children[i] == 0)
+      exit (work (i));
+  }
+  for (i = 0; i <= SMALL_CNT; i++)
+    CHECK (wait (children[i]) == 0, "wait for child %d", i);
+}
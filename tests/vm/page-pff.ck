@@ -0,0 +1,13 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(page-pff) begin
+(page-pff) wait for child 0
+(page-pff) wait for child 1
+(page-pff) wait for child 2
+(page-pff) wait for child 3
+(page-pff) end
+EOF
+pass;
@@ -0,0 +1,27 @@
+/* Runs CHILD_CNT child-linear processes at once in a user pool too
+   small for all of them, so that they fault concurrently while the
+   background reclaim thread evicts pages.  The kernel reports the
+   fault latency distribution and the reclaim counters at power off. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define CHILD_CNT 8
+
+void
+test_main (void)
+{
+  pid_t children[CHILD_CNT];
+  int i;
+
+  for (i = 0; i < CHILD_CNT; i++) {
+    children[i] = fork ("child-linear");
+    if (children[i] == 0) {
+      if (exec ("child-linear") == -1)
+        fail ("failed to exec child-linear");
+    }
+  }
+  for (i = 0; i < CHILD_CNT; i++)
+    CHECK (wait (children[i]) == 0x42, "wait for child %d", i);
+}
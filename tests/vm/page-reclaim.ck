@@ -0,0 +1,17 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(page-reclaim) begin
+(page-reclaim) wait for child 0
+(page-reclaim) wait for child 1
+(page-reclaim) wait for child 2
+(page-reclaim) wait for child 3
+(page-reclaim) wait for child 4
+(page-reclaim) wait for child 5
+(page-reclaim) wait for child 6
+(page-reclaim) wait for child 7
+(page-reclaim) end
+EOF
+pass;
@@ -0,0 +1,47 @@
+/* Thrashing benchmark.  Runs CHILD_CNT child-linear processes at
+   once, as page-parallel does, while the parent keeps sweeping a
+   swap-iter style sparse region, so that the combined working set
+   is well beyond the user pool.  The kernel reports the number of
+   faults and evictions at power off. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define CHILD_CNT 6
+#define PAGE_SIZE 4096
+#define CHUNK_SIZE (4 * 1024 * 1024)
+#define PAGE_COUNT (CHUNK_SIZE / PAGE_SIZE)
+#define PASS_CNT 3
+
+static char big_chunks[CHUNK_SIZE];
+
+void
+test_main (void)
+{
+  pid_t children[CHILD_CNT];
+  size_t i;
+  int pass;
+
+  msg ("write sparsely over %d pages", PAGE_COUNT);
+  for (i = 0; i < PAGE_COUNT; i++)
+    big_chunks[i * PAGE_SIZE] = (char) i;
+
+  for (i = 0; i < CHILD_CNT; i++) {
+    children[i] = fork ("child-linear");
+    if (children[i] == 0) {
+      if (exec ("child-linear") == -1)
+        fail ("failed to exec child-linear");
+    }
+  }
+
+  for (pass = 0; pass < PASS_CNT; pass++) {
+    for (i = 0; i < PAGE_COUNT; i++)
+      if (big_chunks[i * PAGE_SIZE] != (char) i)
+        fail ("data is inconsistent in page %zu", i);
+    msg ("check consistency, pass %d", pass);
+  }
+
+  for (i = 0; i < CHILD_CNT; i++)
+    CHECK (wait (children[i]) == 0x42, "wait for child %zu", i);
+}
@@ -0,0 +1,19 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(page-thrash) begin
+(page-thrash) write sparsely over 1024 pages
+(page-thrash) check consistency, pass 0
+(page-thrash) check consistency, pass 1
+(page-thrash) check consistency, pass 2
+(page-thrash) wait for child 0
+(page-thrash) wait for child 1
+(page-thrash) wait for child 2
+(page-thrash) wait for child 3
+(page-thrash) wait for child 4
+(page-thrash) wait for child 5
+(page-thrash) end
+EOF
+pass;
@@ -0,0 +1,52 @@
+/* Grows the heap with sbrk(), checks that new heap memory reads as
+   zeros and holds what is written to it, shrinks the heap and grows
+   it again, and checks that the heap cannot shrink below its start. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE_SIZE 4096
+#define GROW_SIZE (10 * PAGE_SIZE + 100)
+
+void
+test_main (void)
+{
+  char *start, *p;
+  size_t i;
+
+  start = sbrk (0);
+  CHECK (start != (void *) -1, "sbrk (0)");
+  CHECK (sbrk (GROW_SIZE) == start, "grow heap");
+  CHECK (sbrk (0) == start + GROW_SIZE, "break moved");
+
+  for (i = 0; i < GROW_SIZE; i++)
+    if (start[i] != 0)
+      fail ("new heap byte %zu is not zero", i);
+  for (i = 0; i < GROW_SIZE; i++)
+    start[i] = (char) (i % 253);
+  for (i = 0; i < GROW_SIZE; i++)
+    if (start[i] != (char) (i % 253))
+      fail ("heap byte %zu is wrong", i);
+  msg ("heap holds its data");
+
+  CHECK (sbrk (-(GROW_SIZE - PAGE_SIZE)) == start + GROW_SIZE,
+         "shrink heap");
+  for (i = 0; i < PAGE_SIZE; i++)
+    if (start[i] != (char) (i % 253))
+      fail ("kept heap byte %zu is wrong", i);
+  CHECK (sbrk (GROW_SIZE) == start + PAGE_SIZE, "grow heap again");
+  p = start + PAGE_SIZE;
+  for (i = 0; i < GROW_SIZE; i++)
+    if (p[i] != 0)
+      fail ("regrown heap byte %zu is not zero", i);
+  msg ("regrown heap reads as zeros");
+
+  CHECK (sbrk (-(intptr_t) (2 * GROW_SIZE)) == (void *) -1,
+         "shrinking below the start fails");
+  p = start + PAGE_SIZE + GROW_SIZE;
+  CHECK (sbrk (-(intptr_t) (PAGE_SIZE + GROW_SIZE)) == p,
+         "shrink heap to empty");
+  CHECK (sbrk (0) == start, "break is back at the start");
+}
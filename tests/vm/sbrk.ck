@@ -0,0 +1,19 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(sbrk) begin
+(sbrk) sbrk (0)
+(sbrk) grow heap
+(sbrk) break moved
+(sbrk) heap holds its data
+(sbrk) shrink heap
+(sbrk) grow heap again
+(sbrk) regrown heap reads as zeros
+(sbrk) shrinking below the start fails
+(sbrk) shrink heap to empty
+(sbrk) break is back at the start
+(sbrk) end
+EOF
+pass;
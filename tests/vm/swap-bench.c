@@ -0,0 +1,38 @@
+/* Swap throughput benchmark.  Fills an anonymous region four times
+   the size of the user pool page by page, then streams back through
+   it twice, so that nearly every page is swapped out and swapped in.
+   The kernel reports swap-out and swap-in counts, disk requests and
+   ticks at power off, from which throughput is derived.  For the
+   figures before clustering, run the same test on a kernel built
+   from the tree before it; no such figures are recorded here. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE_SIZE 4096
+#define CHUNK_SIZE (16 * 1024 * 1024)
+#define PAGE_COUNT (CHUNK_SIZE / PAGE_SIZE)
+#define PASS_CNT 2
+
+static char big_chunks[CHUNK_SIZE];
+
+void
+test_main (void)
+{
+  size_t i, j;
+  int pass;
+
+  msg ("fill %d pages", PAGE_COUNT);
+  for (i = 0; i < PAGE_COUNT; i++)
+    for (j = 0; j < PAGE_SIZE; j += 512)
+      big_chunks[i * PAGE_SIZE + j] = (char) (i + j);
+
+  for (pass = 0; pass < PASS_CNT; pass++) {
+    for (i = 0; i < PAGE_COUNT; i++)
+      for (j = 0; j < PAGE_SIZE; j += 512)
+        if (big_chunks[i * PAGE_SIZE + j] != (char) (i + j))
+          fail ("data is inconsistent in page %zu", i);
+    msg ("stream back, pass %d", pass);
+  }
+}
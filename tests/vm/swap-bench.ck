@@ -0,0 +1,12 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(swap-bench) begin
+(swap-bench) fill 4096 pages
+(swap-bench) stream back, pass 0
+(swap-bench) stream back, pass 1
+(swap-bench) end
+EOF
+pass;
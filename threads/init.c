@@ -36,6 +36,8 @@
 #include "devices/disk.h"
 #include "filesys/filesys.h"
 #include "filesys/fsutil.h"
+#include "filesys/page_cache.h"
+#include "filesys/dcache.h"
 #endif
 
 /* Page-map-level-4 with kernel mappings only. */
@@ -164,6 +166,7 @@ paging_init (uint64_t mem_end) {
 
 	// reload cr3
 	pml4_activate(0);
+	pcid_init ();
 }
 
 /* Breaks the kernel command line into words and returns them as
@@ -225,6 +228,14 @@ parse_options (char **argv) {
 			user_page_limit = atoi (value);
 		else if (!strcmp (name, "-threads-tests"))
 			thread_tests = true;
+#endif
+#ifdef VM
+		else if (!strcmp (name, "-nohuge"))
+			vm_huge_pages = false;
+		else if (!strcmp (name, "-nopff"))
+			vm_pff = false;
+		else if (!strcmp (name, "-ksm"))
+			vm_ksm_scan_rate = atoi (value);
 #endif
 		else
 			PANIC ("unknown option `%s' (use -h for help)", name);
@@ -271,6 +282,7 @@ run_actions (char **argv) {
 		{"rm", 2, fsutil_rm},
 		{"put", 2, fsutil_put},
 		{"get", 2, fsutil_get},
+		{"bench-disk", 1, fsutil_bench},
 #endif
 		{NULL, 0, NULL},
 	};
@@ -315,6 +327,7 @@ usage (void) {
 			"  ls                 List files in the root directory.\n"
 			"  cat FILE           Print FILE to the console.\n"
 			"  rm FILE            Delete FILE.\n"
+			"  bench-disk         Measure raw disk throughput.\n"
 			"Use these actions indirectly via `pintos' -g and -p options:\n"
 			"  put FILE           Put FILE into file system from scratch disk.\n"
 			"  get FILE           Get FILE from file system into scratch disk.\n"
@@ -327,6 +340,12 @@ usage (void) {
 			"  -mlfqs             Use multi-level feedback queue scheduler.\n"
 #ifdef USERPROG
 			"  -ul=COUNT          Limit user memory to COUNT pages.\n"
+#endif
+#ifdef VM
+			"  -nohuge            Do not promote user memory to 2 MiB pages.\n"
+			"  -nopff             Replace pages by the global clock alone.\n"
+			"  -ksm=COUNT         Merge identical user pages, scanning COUNT\n"
+			"                     frames every 100 ms.\n"
 #endif
 			);
 	power_off ();
@@ -355,10 +374,16 @@ print_stats (void) {
 	thread_print_stats ();
 #ifdef FILESYS
 	disk_print_stats ();
+	page_cache_print_stats ();
+	dcache_print_stats ();
 #endif
 	console_print_stats ();
 	kbd_print_stats ();
 #ifdef USERPROG
 	exception_print_stats ();
+	pcid_print_stats ();
+#endif
+#ifdef VM
+	vm_print_stats ();
 #endif
 }
\ No newline at end of file
@@ -1,18 +1,146 @@
 #include <stdbool.h>
 #include <stddef.h>
+#include <stdio.h>
 #include <string.h>
 #include "threads/init.h"
+#include "threads/interrupt.h"
 #include "threads/pte.h"
 #include "threads/palloc.h"
 #include "threads/thread.h"
 #include "threads/mmu.h"
+#include "threads/vaddr.h"
 #include "intrinsic.h"
 
+/* Process-context identifiers (PCIDs).
+ *
+ * If the CPU supports them, each active address space gets a PCID that
+ * tags its TLB entries, so that pml4_activate() can load CR3 with the
+ * no-flush bit and keep the entries of the other address spaces.
+ * PCID 0 belongs to base_pml4, whose kernel-only mappings every pml4
+ * shares.  PCIDs are handed out in order; when they run out the
+ * generation counter is bumped, which revokes every assignment at once,
+ * and address spaces get new PCIDs as they are next activated.  A newly
+ * assigned PCID is always loaded with a flush, since it may still tag
+ * entries of its previous owner.
+ *
+ * invlpg only reaches the TLB entries of the current PCID.  A PTE change
+ * in an address space that is not active therefore marks it stale
+ * instead, and its next activation flushes.
+ *
+ * PCID_SLOTS is only accessed with interrupts off, because the
+ * scheduler activates address spaces. */
+#define PCID_CNT 32                     /* PCIDs in use, including 0. */
+#define CR3_PCID_MASK 0xfffULL          /* PCID bits in CR3. */
+#define CR3_NOFLUSH (1ULL << 63)        /* Keep TLB entries of the PCID. */
+#define CR4_PCIDE (1 << 17)             /* PCID enable. */
+#define CPUID_1_ECX_PCID (1 << 17)      /* PCID support. */
+
+struct pcid_slot {
+	uint64_t *pml4;                 /* Address space, or NULL. */
+	uint64_t gen;                   /* Generation it was assigned in. */
+	bool stale;                     /* Flush on next activation. */
+};
+
+static bool pcid_enabled;
+static struct pcid_slot pcid_slots[PCID_CNT];
+static uint64_t pcid_gen = 1;
+static unsigned pcid_next = 1;
+
+/* Statistics. */
+static long long pcid_switch_cnt;       /* User address space loads. */
+static long long pcid_flush_cnt;        /* ...that flushed the TLB. */
+
+/* Enables PCIDs if the CPU supports them.  Must be called with
+ * base_pml4 loaded with PCID 0. */
+void
+pcid_init (void) {
+	uint32_t eax, ebx, ecx, edx;
+
+	cpuid (1, &eax, &ebx, &ecx, &edx);
+	if (!(ecx & CPUID_1_ECX_PCID))
+		return;
+	ASSERT ((rcr3 () & CR3_PCID_MASK) == 0);
+	lcr4 (rcr4 () | CR4_PCIDE);
+	pcid_enabled = true;
+}
+
+/* Prints PCID statistics. */
+void
+pcid_print_stats (void) {
+	if (pcid_enabled)
+		printf ("PCID: %lld switches, %lld flushed, %"PRIu64" generations\n",
+				pcid_switch_cnt, pcid_flush_cnt, pcid_gen);
+	else
+		printf ("PCID: not supported, every switch flushes\n");
+}
+
+/* Returns the PCID slot assigned to PML4 in the current generation,
+ * or NULL.  Interrupts must be off. */
+static struct pcid_slot *
+pcid_lookup (uint64_t *pml4) {
+	unsigned i;
+
+	ASSERT (intr_get_level () == INTR_OFF);
+	for (i = 1; i < PCID_CNT; i++)
+		if (pcid_slots[i].pml4 == pml4 && pcid_slots[i].gen == pcid_gen)
+			return &pcid_slots[i];
+	return NULL;
+}
+
+/* Assigns a PCID to PML4, starting a new generation if all are taken.
+ * Interrupts must be off. */
+static struct pcid_slot *
+pcid_assign (uint64_t *pml4) {
+	struct pcid_slot *slot;
+
+	ASSERT (intr_get_level () == INTR_OFF);
+	if (pcid_next == PCID_CNT) {
+		pcid_gen++;
+		pcid_next = 1;
+	}
+	slot = &pcid_slots[pcid_next++];
+	slot->pml4 = pml4;
+	slot->gen = pcid_gen;
+	slot->stale = true;
+	return slot;
+}
+
+/* Returns true if PML4 is loaded in CR3. */
+static bool
+pml4_is_active (uint64_t *pml4) {
+	return (rcr3 () & ~CR3_PCID_MASK) == vtop (pml4);
+}
+
+/* Makes the TLB forget VA in PML4, or every user mapping of PML4 if VA
+ * is NULL. */
+static void
+tlb_invalidate (uint64_t *pml4, const void *va) {
+	if (pml4_is_active (pml4)) {
+		if (va != NULL)
+			invlpg ((uint64_t) va);
+		else
+			lcr3 (rcr3 ());
+	} else if (pcid_enabled) {
+		enum intr_level old_level = intr_disable ();
+		struct pcid_slot *slot = pcid_lookup (pml4);
+		if (slot != NULL)
+			slot->stale = true;
+		intr_set_level (old_level);
+	}
+}
+
+/* If VA is mapped by a 2 MiB page, the walk ends at its PDE, which
+ * then stands for every 4 KiB page in it: lookups and accessed/dirty
+ * bit updates apply to the whole huge page.  A huge page cannot be
+ * walked with CREATE, since there is no page table to create a PTE
+ * in; see pml4_clear_page() for how a huge page is split. */
 static uint64_t *
 pgdir_walk (uint64_t *pdp, const uint64_t va, int create) {
 	int idx = PDX (va);
 	if (pdp) {
 		uint64_t *pte = (uint64_t *) pdp[idx];
+		if ((uint64_t) pte & PTE_PS)
+			return create ? NULL : &pdp[idx];
 		if (!((uint64_t) pte & PTE_P)) {
 			if (create) {
 				uint64_t *new_page = palloc_get_page (PAL_ZERO);
@@ -88,6 +216,21 @@ pml4e_walk (uint64_t *pml4e, const uint64_t va, int create) {
 	return pte;
 }
 
+/* Returns the address of the page directory entry for VA in PML4,
+ * or a null pointer if there is no page directory for VA. */
+static uint64_t *
+pde_walk (uint64_t *pml4, const uint64_t va) {
+	uint64_t *pdp, *pd;
+
+	if (!(pml4[PML4 (va)] & PTE_P))
+		return NULL;
+	pdp = ptov (PTE_ADDR (pml4[PML4 (va)]));
+	if (!(pdp[PDPE (va)] & PTE_P))
+		return NULL;
+	pd = ptov (PTE_ADDR (pdp[PDPE (va)]));
+	return &pd[PDX (va)];
+}
+
 /* Creates a new page map level 4 (pml4) has mappings for kernel
  * virtual addresses, but none for user virtual addresses.
  * Returns the new page directory, or a null pointer if memory
@@ -124,6 +267,9 @@ pgdir_for_each (uint64_t *pdp, pte_for_each_func *func, void *aux,
 		unsigned pml4_index, unsigned pdp_index) {
 	for (unsigned i = 0; i < PGSIZE / sizeof(uint64_t *); i++) {
 		uint64_t *pte = ptov((uint64_t *) pdp[i]);
+		/* Huge pages have no PTEs to visit. */
+		if (((uint64_t) pte) & PTE_PS)
+			continue;
 		if (((uint64_t) pte) & PTE_P)
 			if (!pt_for_each ((uint64_t *) PTE_ADDR (pte), func, aux,
 					pml4_index, pdp_index, i))
@@ -171,7 +317,9 @@ static void
 pgdir_destroy (uint64_t *pdp) {
 	for (unsigned i = 0; i < PGSIZE / sizeof(uint64_t *); i++) {
 		uint64_t *pte = ptov((uint64_t *) pdp[i]);
-		if (((uint64_t) pte) & PTE_P)
+		if (((uint64_t) pte) & PTE_PS)
+			palloc_free_multiple ((void *) PTE_ADDR (pte), HPG_PAGE_CNT);
+		else if (((uint64_t) pte) & PTE_P)
 			pt_destroy (PTE_ADDR (pte));
 	}
 	palloc_free_page ((void *) pdp);
@@ -194,6 +342,14 @@ pml4_destroy (uint64_t *pml4) {
 		return;
 	ASSERT (pml4 != base_pml4);
 
+	if (pcid_enabled) {
+		enum intr_level old_level = intr_disable ();
+		struct pcid_slot *slot = pcid_lookup (pml4);
+		if (slot != NULL)
+			slot->pml4 = NULL;
+		intr_set_level (old_level);
+	}
+
 	/* if PML4 (vaddr) >= 1, it's kernel space by define. */
 	uint64_t *pdpe = ptov ((uint64_t *) pml4[0]);
 	if (((uint64_t) pdpe) & PTE_P)
@@ -202,10 +358,36 @@ pml4_destroy (uint64_t *pml4) {
 }
 
 /* Loads page directory PD into the CPU's page directory base
- * register. */
+ * register.  With PCIDs, the TLB entries of PD survive from its last
+ * activation unless it was changed while inactive. */
 void
 pml4_activate (uint64_t *pml4) {
-	lcr3 (vtop (pml4 ? pml4 : base_pml4));
+	struct pcid_slot *slot;
+	enum intr_level old_level;
+
+	if (pml4 == NULL)
+		pml4 = base_pml4;
+	if (!pcid_enabled) {
+		lcr3 (vtop (pml4));
+		return;
+	}
+	if (pml4 == base_pml4) {
+		lcr3 (vtop (pml4) | CR3_NOFLUSH);
+		return;
+	}
+
+	old_level = intr_disable ();
+	slot = pcid_lookup (pml4);
+	if (slot == NULL)
+		slot = pcid_assign (pml4);
+	pcid_switch_cnt++;
+	if (slot->stale) {
+		slot->stale = false;
+		pcid_flush_cnt++;
+		lcr3 (vtop (pml4) | (slot - pcid_slots));
+	} else
+		lcr3 (vtop (pml4) | (slot - pcid_slots) | CR3_NOFLUSH);
+	intr_set_level (old_level);
 }
 
 /* Looks up the physical address that corresponds to user virtual
@@ -221,7 +403,8 @@ pml4_get_page (uint64_t *pml4, const void *uaddr) {
 	uint64_t *pte = pml4e_walk (pml4, (uint64_t) uaddr, 0);
 
 	if (pte && (*pte & PTE_P))
-		return ptov (PTE_ADDR (*pte)) + pg_ofs (uaddr);
+		return ptov (PTE_ADDR (*pte)) + ((*pte & PTE_PS)
+				? ((uint64_t) uaddr & HPGMASK) : pg_ofs (uaddr));
 	return NULL;
 }
 
@@ -248,9 +431,91 @@ pml4_set_page (uint64_t *pml4, void *upage, void *kpage, bool rw) {
 	return pte != NULL;
 }
 
+/* Returns true if user virtual address UADDR is mapped by a 2 MiB
+ * page in PML4. */
+bool
+pml4_is_huge (uint64_t *pml4, const void *uaddr) {
+	uint64_t *pde = pde_walk (pml4, (uint64_t) uaddr);
+	return pde != NULL && (*pde & PTE_PS) != 0;
+}
+
+/* Returns true if the 2 MiB region at HPAGE in PML4 is mapped by
+ * 4 KiB pages that are all present and agree on being writable,
+ * so that a single huge page could map it instead. */
+bool
+pml4_huge_candidate (uint64_t *pml4, const void *hpage) {
+	uint64_t *pde = pde_walk (pml4, (uint64_t) hpage);
+	uint64_t *pt;
+	size_t i;
+
+	ASSERT (((uint64_t) hpage & HPGMASK) == 0);
+
+	if (pde == NULL || !(*pde & PTE_P) || (*pde & PTE_PS))
+		return false;
+	pt = ptov (PTE_ADDR (*pde));
+
+	/* Regions usually fill front to back, so check the last page
+	 * first to give up early. */
+	if (!(pt[HPG_PAGE_CNT - 1] & PTE_P))
+		return false;
+	for (i = 0; i < HPG_PAGE_CNT; i++)
+		if (!(pt[i] & PTE_P) || ((pt[i] ^ pt[0]) & PTE_W))
+			return false;
+	return true;
+}
+
+/* Replaces the 4 KiB mappings of the 2 MiB region at HPAGE in PML4
+ * by a single huge page mapping the HPG_PAGE_CNT contiguous frames
+ * at KPAGE, and frees the region's page table.  The region must
+ * satisfy pml4_huge_candidate().  Accessed and dirty bits of the
+ * old mappings carry over to the huge page. */
+void
+pml4_set_huge_page (uint64_t *pml4, void *hpage, void *kpage, bool rw) {
+	uint64_t *pde = pde_walk (pml4, (uint64_t) hpage);
+	uint64_t *pt, ad = 0;
+	size_t i;
+
+	ASSERT (((uint64_t) hpage & HPGMASK) == 0);
+	ASSERT ((vtop (kpage) & HPGMASK) == 0);
+	ASSERT (pde != NULL && (*pde & PTE_P) && !(*pde & PTE_PS));
+
+	pt = ptov (PTE_ADDR (*pde));
+	for (i = 0; i < HPG_PAGE_CNT; i++)
+		ad |= pt[i] & (PTE_A | PTE_D);
+	*pde = vtop (kpage) | PTE_P | PTE_PS | PTE_U | (rw ? PTE_W : 0) | ad;
+	palloc_free_page (pt);
+	tlb_invalidate (pml4, NULL);
+}
+
+/* Splits the huge page mapping UPAGE in PML4, if any, back into
+ * 4 KiB mappings of the same frames with the same bits.  If no
+ * page table can be allocated, the whole huge page is unmapped
+ * instead; its pages then fault and are mapped again one by one. */
+static void
+split_huge_page (uint64_t *pml4, void *upage) {
+	uint64_t *pde = pde_walk (pml4, (uint64_t) upage);
+	uint64_t *pt, pa, flags;
+	size_t i;
+
+	if (pde == NULL || !(*pde & PTE_PS))
+		return;
+
+	pt = palloc_get_page (0);
+	if (pt != NULL) {
+		pa = PTE_ADDR (*pde);
+		flags = *pde & PTE_FLAGS & ~PTE_PS;
+		for (i = 0; i < HPG_PAGE_CNT; i++)
+			pt[i] = (pa + i * PGSIZE) | flags;
+		*pde = vtop (pt) | PTE_U | PTE_W | PTE_P;
+	} else
+		*pde = 0;
+	tlb_invalidate (pml4, upage);
+}
+
 /* Marks user virtual page UPAGE "not present" in page
  * directory PD.  Later accesses to the page will fault.  Other
  * bits in the page table entry are preserved.
+ * If UPAGE is part of a huge page, the huge page is split first.
  * UPAGE need not be mapped. */
 // ▶ pml4에서 upage를 존재하지 않음으로 표시한다. -> 이후 이 페이지 접근 시 fault 발생
 void
@@ -259,12 +524,12 @@ pml4_clear_page (uint64_t *pml4, void *upage) {
 	ASSERT (pg_ofs (upage) == 0);
 	ASSERT (is_user_vaddr (upage));
 
+	split_huge_page (pml4, upage);
 	pte = pml4e_walk (pml4, (uint64_t) upage, false);
 
 	if (pte != NULL && (*pte & PTE_P) != 0) {
 		*pte &= ~PTE_P;
-		if (rcr3 () == vtop (pml4))
-			invlpg ((uint64_t) upage);
+		tlb_invalidate (pml4, upage);
 	}
 }
 
@@ -288,9 +553,7 @@ pml4_set_dirty (uint64_t *pml4, const void *vpage, bool dirty) {
 			*pte |= PTE_D;
 		else
 			*pte &= ~(uint32_t) PTE_D;
-
-		if (rcr3 () == vtop (pml4))
-			invlpg ((uint64_t) vpage);
+		tlb_invalidate (pml4, vpage);
 	}
 }
 
@@ -314,8 +577,6 @@ pml4_set_accessed (uint64_t *pml4, const void *vpage, bool accessed) {
 			*pte |= PTE_A;
 		else
 			*pte &= ~(uint32_t) PTE_A;
-
-		if (rcr3 () == vtop (pml4))
-			invlpg ((uint64_t) vpage);
+		tlb_invalidate (pml4, vpage);
 	}
 }
@@ -296,6 +296,37 @@ palloc_get_page (enum palloc_flags flags) {
 	return palloc_get_multiple (flags, 1);
 }
 
+/* Obtains HPG_PAGE_CNT contiguous free pages from the user pool
+   that start on a 2 MiB physical boundary, so that they can be
+   mapped as one huge page, and returns the kernel virtual address
+   of the first.  If PAL_ZERO is set in FLAGS, the pages are
+   filled with zeros.  Returns a null pointer if the user pool has
+   no such run, e.g. because it is fragmented; the pages may be
+   freed one at a time with palloc_free_page(). */
+void *
+palloc_get_huge_page (enum palloc_flags flags) {
+	struct pool *pool = &user_pool;
+	uint64_t base = vtop (pool->base);
+	size_t page_idx = pg_no (ROUND_UP (base, HPGSIZE)) - pg_no (base);
+	void *pages = NULL;
+
+	ASSERT (flags & PAL_USER);
+
+	lock_acquire (&pool->lock);
+	for (; page_idx + HPG_PAGE_CNT <= bitmap_size (pool->used_map);
+			page_idx += HPG_PAGE_CNT)
+		if (bitmap_none (pool->used_map, page_idx, HPG_PAGE_CNT)) {
+			bitmap_set_multiple (pool->used_map, page_idx, HPG_PAGE_CNT, true);
+			pages = pool->base + PGSIZE * page_idx;
+			break;
+		}
+	lock_release (&pool->lock);
+
+	if (pages != NULL && (flags & PAL_ZERO))
+		memset (pages, 0, HPGSIZE);
+	return pages;
+}
+
 /* Frees the PAGE_CNT pages starting at PAGES. */
 void
 palloc_free_multiple (void *pages, size_t page_cnt) {
@@ -328,6 +359,20 @@ palloc_free_page (void *page) {
 	palloc_free_multiple (page, 1);
 }
 
+/* Returns the number of pages in the user pool. */
+size_t
+palloc_user_page_cnt (void) {
+	return bitmap_size (user_pool.used_map);
+}
+
+/* Returns the index of KPAGE within the user pool.  KPAGE must
+   have been obtained with palloc_get_page (PAL_USER). */
+size_t
+palloc_user_page_idx (const void *kpage) {
+	ASSERT (page_from_pool (&user_pool, (void *) kpage));
+	return pg_no (kpage) - pg_no (user_pool.base);
+}
+
 /* Initializes pool P as starting at START and ending at END */
 static void
 init_pool (struct pool *p, void **bm_base, uint64_t start, uint64_t end) {
@@ -514,4 +514,71 @@ void cond_broadcast(struct condition *cond, struct lock *lock)
 
 	while (!list_empty(&cond->waiters))
 		cond_signal(cond, lock);
-}
\ No newline at end of file
+}
+/* Initializes RWLOCK.  Any number of readers may hold a readers-
+   writer lock at once, or else a single writer.  A writer that is
+   waiting keeps new readers out, so that a steady stream of readers
+   cannot starve it. */
+void
+rwlock_init (struct rwlock *rwlock)
+{
+	ASSERT (rwlock != NULL);
+
+	lock_init (&rwlock->lock);
+	cond_init (&rwlock->readers);
+	cond_init (&rwlock->writers);
+	rwlock->reader_cnt = 0;
+	rwlock->waiting_writer_cnt = 0;
+	rwlock->writer = false;
+}
+
+/* Acquires RWLOCK for reading, sleeping until no writer holds it or
+   waits for it. */
+void
+rwlock_acquire_read (struct rwlock *rwlock)
+{
+	lock_acquire (&rwlock->lock);
+	while (rwlock->writer || rwlock->waiting_writer_cnt > 0)
+		cond_wait (&rwlock->readers, &rwlock->lock);
+	rwlock->reader_cnt++;
+	lock_release (&rwlock->lock);
+}
+
+/* Releases RWLOCK, held for reading. */
+void
+rwlock_release_read (struct rwlock *rwlock)
+{
+	lock_acquire (&rwlock->lock);
+	ASSERT (rwlock->reader_cnt > 0);
+	if (--rwlock->reader_cnt == 0)
+		cond_signal (&rwlock->writers, &rwlock->lock);
+	lock_release (&rwlock->lock);
+}
+
+/* Acquires RWLOCK for writing, sleeping until no one else holds
+   it. */
+void
+rwlock_acquire_write (struct rwlock *rwlock)
+{
+	lock_acquire (&rwlock->lock);
+	rwlock->waiting_writer_cnt++;
+	while (rwlock->writer || rwlock->reader_cnt > 0)
+		cond_wait (&rwlock->writers, &rwlock->lock);
+	rwlock->waiting_writer_cnt--;
+	rwlock->writer = true;
+	lock_release (&rwlock->lock);
+}
+
+/* Releases RWLOCK, held for writing. */
+void
+rwlock_release_write (struct rwlock *rwlock)
+{
+	lock_acquire (&rwlock->lock);
+	ASSERT (rwlock->writer);
+	rwlock->writer = false;
+	if (rwlock->waiting_writer_cnt > 0)
+		cond_signal (&rwlock->writers, &rwlock->lock);
+	else
+		cond_broadcast (&rwlock->readers, &rwlock->lock);
+	lock_release (&rwlock->lock);
+}
@@ -384,17 +384,11 @@ void process_exit(void)
    for (int i = 2; i < 64; i++)
       close(i);
    file_close(cur->running_file);
+   if (cur->bounce != NULL)
+      palloc_free_multiple(cur->bounce, cur->bounce_cnt);
 
-   if ( hash_size(&cur->spt.table) != 0){
-   struct hash_iterator i;
-   hash_first (&i, &cur->spt.table);
-   
-      while (hash_next (&i))
-      {
-         struct page *page = hash_entry (hash_cur (&i), struct page, hash_elem);
-         do_munmap(page->va);
-      }
-   }
+   /* File mappings are written back and closed when process_cleanup()
+    * tears down the SPT. */
    sema_up(&cur->exit_sema);
    sema_down(&cur->free_sema);
    process_cleanup(); // pml4를 날림(이 함수를 call 한 thread의 pml4)
@@ -513,6 +507,7 @@ load(const char *file_name, struct intr_frame *if_)
    struct file *file = NULL;
    off_t file_ofs;
    bool success = false;
+   uint64_t load_end = 0;
    int i;
 
    /* Allocate and activate page directory. */
@@ -594,6 +589,8 @@ load(const char *file_name, struct intr_frame *if_)
             if (!load_segment(file, file_page, (void *)mem_page,
                               read_bytes, zero_bytes, writable))
                goto done;
+            if (mem_page + read_bytes + zero_bytes > load_end)
+               load_end = mem_page + read_bytes + zero_bytes;
          }
          else
             goto done;
@@ -605,6 +602,11 @@ load(const char *file_name, struct intr_frame *if_)
    if (!setup_stack(if_))
       goto done;
 
+#ifdef VM
+   /* The heap starts out empty right past the loaded segments. */
+   vm_heap_init((void *)load_end);
+#endif
+
    /* Start address. */
    if_->rip = ehdr.e_entry;
 
@@ -786,13 +788,11 @@ lazy_load_segment(struct page *page, void *aux)
       //    return false;
       
       struct lazy_load_file* temp_aux = (struct lazy_load_file*)aux;
-      file_seek(temp_aux->file, temp_aux->ofs);
-      /* Load this page. */
-      if (file_read(temp_aux->file, frame->kva, temp_aux->page_read_bytes) != (int)temp_aux->page_read_bytes)
-      { 
-         palloc_free_page(frame->kva);
+      /* Load this page.  Read at an explicit offset rather than seeking:
+       * fault-around loads several pages of the same file in a row, and
+       * the frame belongs to the frame table, which frees it on error. */
+      if (file_read_at(temp_aux->file, frame->kva, temp_aux->page_read_bytes, temp_aux->ofs) != (int)temp_aux->page_read_bytes)
          return false;
-      }
       memset(frame->kva + temp_aux->page_read_bytes, 0, temp_aux->page_zero_bytes);
       
       if ( page->operations->type == VM_FILE){
@@ -800,6 +800,8 @@ lazy_load_segment(struct page *page, void *aux)
          page->file.offset = temp_aux->ofs;
          page->file.page_read_bytes = temp_aux->page_read_bytes;
       }
+      else if (page->operations->type == VM_ANON)
+         page->anon.file_data = temp_aux->page_read_bytes > 0;
       return true;
 }
 
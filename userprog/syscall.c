@@ -32,6 +32,7 @@ bool remove(const char *file);
 int open(const char *file);
 int filesize(int fd);
 int read(int fd, void *buffer, unsigned size);
+static int file_io_bounce(struct file *file, void *buffer, unsigned size, bool to_file);
 int write(int fd, const void *buffer, unsigned size);
 void seek(int fd, unsigned position);
 unsigned tell(int fd);
@@ -42,6 +43,11 @@ void check_valid_string (const void* str) ;
 void check_valid_buffer (void *buffer, unsigned size);
 void *mmap (void *addr, size_t length, int writable, int fd, off_t offset);
 void munmap (void *addr);
+int msync (void *addr, size_t length);
+int madvise (void *addr, size_t length, int advice);
+int mlock (const void *addr, size_t length);
+int munlock (const void *addr, size_t length);
+void *sbrk (intptr_t increment);
 
 /* System call.
  *
@@ -130,6 +136,21 @@ void syscall_handler(struct intr_frame *f UNUSED)
    case SYS_MUNMAP:
       munmap(f->R.rdi);
       break;
+   case SYS_MSYNC:
+      f->R.rax = msync((void *) f->R.rdi, f->R.rsi);
+      break;
+   case SYS_MADVISE:
+      f->R.rax = madvise((void *) f->R.rdi, f->R.rsi, f->R.rdx);
+      break;
+   case SYS_MLOCK:
+      f->R.rax = mlock((void *) f->R.rdi, f->R.rsi);
+      break;
+   case SYS_MUNLOCK:
+      f->R.rax = munlock((void *) f->R.rdi, f->R.rsi);
+      break;
+   case SYS_SBRK:
+      f->R.rax = (uint64_t) sbrk(f->R.rdi);
+      break;
    default:
       thread_exit();
    }
@@ -252,6 +273,88 @@ int filesize(int fd)
       return -1;
    return file_length(find_file);
 }
+/* Largest kernel buffer read() and write() copy through, in pages. */
+#define BOUNCE_PAGES 16
+
+/* Returns the current thread's bounce buffer and stores its size in
+   pages into *PAGE_CNT, or returns a null pointer if there is no
+   memory for one.  The buffer is allocated on first use and kept
+   until the process exits, so read() and write() do not go to the
+   page allocator on every call. */
+static uint8_t *get_bounce(size_t *page_cnt)
+{
+   struct thread *cur = thread_current();
+
+   if (cur->bounce == NULL)
+   {
+      cur->bounce = palloc_get_multiple(0, BOUNCE_PAGES);
+      cur->bounce_cnt = BOUNCE_PAGES;
+      if (cur->bounce == NULL)
+      {
+         cur->bounce = palloc_get_page(0);
+         cur->bounce_cnt = 1;
+      }
+   }
+   *page_cnt = cur->bounce_cnt;
+   return cur->bounce;
+}
+
+/* Reads (or, if TO_FILE, writes) SIZE bytes between FILE and the user
+   BUFFER through the thread's bounce buffer, and returns the bytes
+   transferred.  The file system never touches user memory then, so a
+   page fault on BUFFER, e.g. on an mmap of the same file, is taken
+   here with no file system lock held. */
+static int file_io_bounce(struct file *file, void *buffer, unsigned size, bool to_file)
+{
+   size_t page_cnt;
+   uint8_t *bounce;
+   unsigned done = 0;
+
+   if (size == 0)
+   {
+      return to_file ? file_write(file, buffer, 0) : file_read(file, buffer, 0);
+   }
+   bounce = get_bounce(&page_cnt);
+   if (bounce == NULL)
+   {
+      return -1;
+   }
+
+   while (done < size)
+   {
+      unsigned chunk = size - done;
+      int n;
+
+      if (chunk > page_cnt * PGSIZE)
+      {
+         chunk = page_cnt * PGSIZE;
+      }
+      if (to_file)
+      {
+         memcpy(bounce, (uint8_t *) buffer + done, chunk);
+         n = file_write(file, bounce, chunk);
+      }
+      else
+      {
+         n = file_read(file, bounce, chunk);
+         if (n > 0)
+         {
+            memcpy((uint8_t *) buffer + done, bounce, n);
+         }
+      }
+      if (n <= 0)
+      {
+         break;
+      }
+      done += n;
+      if ((unsigned) n < chunk)
+      {
+         break;
+      }
+   }
+   return done;
+}
+
 /*
 buffer 안에 fd 로 열려있는 파일로부터 size 바이트를 읽습니다.
 실제로 읽어낸 바이트의 수 를 반환합니다 (파일 끝에서 시도하면 0).
@@ -287,9 +390,9 @@ int read(int fd, void *buffer, unsigned size)
       {
          return -1;
       }
-      lock_acquire(&filesys_lock);
-      file_size = file_read(read_file, buffer, size);
-      lock_release(&filesys_lock);
+      /* The file system locks each inode itself, so reads of
+         different files, or of one file, overlap their disk waits. */
+      file_size = file_io_bounce(read_file, buffer, size, false);
    }
    return file_size;
 }
@@ -319,9 +422,7 @@ int write(int fd, const void *buffer, unsigned size)
       {
          return -1;
       }
-      lock_acquire(&filesys_lock);
-      file_size = file_write(read_file, buffer, size);
-      lock_release(&filesys_lock);
+      file_size = file_io_bounce(read_file, (void *) buffer, size, true);
    }
 
    return file_size;
@@ -417,6 +518,10 @@ void check_valid_buffer (void *buffer, unsigned size) {
 
 
 void *mmap (void *addr, size_t length, int writable, int fd, off_t offset){
+   // fd가 -1이면 파일 없는 익명 매핑
+   if (fd == -1)
+      return vm_mmap_anon(addr, length, writable);
+
    struct file *file = process_get_file(fd);
    struct page * page = spt_find_page(&thread_current()->spt, addr);
    
@@ -438,4 +543,24 @@ void *mmap (void *addr, size_t length, int writable, int fd, off_t offset){
 
 void munmap (void *addr){
  do_munmap(addr);
-}
\ No newline at end of file
+}
+
+int msync (void *addr, size_t length){
+   return do_msync(addr, length);
+}
+
+int madvise (void *addr, size_t length, int advice){
+   return vm_madvise(addr, length, advice);
+}
+
+int mlock (const void *addr, size_t length){
+   return vm_mlock(addr, length, true);
+}
+
+int munlock (const void *addr, size_t length){
+   return vm_mlock(addr, length, false);
+}
+
+void *sbrk (intptr_t increment){
+   return vm_sbrk(increment);
+}
@@ -1,13 +1,48 @@
 /* anon.c: Implementation of page for non-disk image (a.k.a. anonymous page). */
 
 #include "vm/vm.h"
+#include "vm/text.h"
+#include "vm/zswap.h"
 #include "devices/disk.h"
+#include "devices/timer.h"
 #include "threads/mmu.h"
+#include "threads/palloc.h"
+#include "threads/synch.h"
+#include <stdio.h>
+#include <syscall-nr.h>
+#include <string.h>
 
 /* DO NOT MODIFY BELOW LINE */
 static struct disk *swap_disk;	
 struct bitmap *swap_bitmap;		// 사용 가능&불가능한 swap slot(disk)을 관리하는 자료구조
 
+/* Number of swap disk sectors that back one page (one swap slot). */
+#define SECTORS_PER_SLOT (PGSIZE / DISK_SECTOR_SIZE)
+
+/* SWAP_LOCK protects SWAP_BITMAP, the next-fit cursor and the cluster
+ * buffer that evicted pages are gathered into before a cluster write. */
+static struct lock swap_lock;
+static size_t swap_cursor;
+static uint8_t *swap_cluster_buf;
+
+/* Swap readahead window, in pages read ahead of the faulting one.
+ * Grows by one on every readahead hit and halves on every miss. */
+#define RA_WINDOW_MIN 1
+#define RA_WINDOW_MAX (SWAP_CLUSTER_MAX - 1)
+static size_t ra_window = RA_WINDOW_MAX / 2;
+
+/* Statistics. */
+static long long swap_out_cnt;          /* Pages written to swap. */
+static long long swap_out_writes;       /* Disk write requests issued. */
+static long long swap_out_ticks;        /* Ticks spent swapping out. */
+static long long swap_in_cnt;           /* Pages read back from swap. */
+static long long swap_in_ticks;         /* Ticks spent swapping in. */
+static long long pool_in_cnt;           /* Pages read back from the pool. */
+static long long pool_in_ticks;         /* Ticks spent reading them. */
+static long long ra_cnt;                /* Pages read ahead. */
+static long long ra_hit_cnt;            /* ...later faulted on. */
+static long long ra_miss_cnt;           /* ...dropped unused. */
+
 static bool anon_swap_in (struct page *page, void *kva);
 static bool anon_swap_out (struct page *page);
 static void anon_destroy (struct page *page);
@@ -28,6 +63,25 @@ vm_anon_init (void) {
 	swap_bitmap = bitmap_create(disk_size(swap_disk)/8);
 	// swap_bitmap = bitmap_create(disk_size(swap_disk));
 
+	lock_init (&swap_lock);
+	swap_cursor = 0;
+	swap_cluster_buf = palloc_get_multiple (PAL_ASSERT, SWAP_CLUSTER_MAX);
+	zswap_init ();
+}
+
+/* Prints swap statistics. */
+void
+anon_print_stats (void) {
+	printf ("Swap: %lld pages out in %lld writes (%lld ticks), "
+			"%lld pages in (%lld ticks)\n",
+			swap_out_cnt, swap_out_writes, swap_out_ticks,
+			swap_in_cnt, swap_in_ticks);
+	printf ("Swap readahead: %lld pages, %lld hits, %lld misses\n",
+			ra_cnt, ra_hit_cnt, ra_miss_cnt);
+	printf ("Swap pool: %lld pages in (%lld ticks), %lld%% of all swap-ins\n",
+			pool_in_cnt, pool_in_ticks,
+			pool_in_cnt ? pool_in_cnt * 100 / (pool_in_cnt + swap_in_cnt) : 0);
+	zswap_print_stats ();
 }
 
 /* Initialize the file mapping */
@@ -43,58 +97,321 @@ anon_initializer (struct page *page, enum vm_type type, void *kva) {
 
 	// ★★★
 	anon_page->swap_index = -1;
+	anon_page->prefetched = false;
+	anon_page->text = NULL;
+	anon_page->zero = false;
+	anon_page->zswap = NULL;
+	anon_page->ksm = NULL;
+	anon_page->file_data = false;
 
 	return true;
 }
 
-/* Swap in the page by read contents from the swap disk. */
+/* Allocates CNT contiguous swap slots and returns the first one, or
+ * BITMAP_ERROR if there is no such run.  The search starts at the
+ * next-fit cursor, so that clusters written one after another also sit
+ * one after another on the swap disk.
+ * Must be called with SWAP_LOCK held. */
+static size_t
+swap_slot_alloc (size_t cnt) {
+	size_t slot = bitmap_scan_and_flip (swap_bitmap, swap_cursor, cnt, false);
+
+	if (slot == BITMAP_ERROR && swap_cursor != 0)
+		slot = bitmap_scan_and_flip (swap_bitmap, 0, cnt, false);
+	if (slot != BITMAP_ERROR)
+		swap_cursor = (slot + cnt) % bitmap_size (swap_bitmap);
+	return slot;
+}
+
+/* Records that a page brought in by readahead was dropped unused and
+ * shrinks the window.  The page's swap slot still holds its contents.
+ * Must be called with SWAP_LOCK held. */
+static void
+readahead_miss (struct page *page) {
+	page->anon.prefetched = false;
+	ra_miss_cnt++;
+	ra_window = ra_window / 2 > RA_WINDOW_MIN ? ra_window / 2 : RA_WINDOW_MIN;
+}
+
+/* Called when the process faults on PAGE, which readahead brought in
+ * and which is now mapped: releases its swap slot and grows the window. */
+void
+anon_readahead_hit (struct page *page) {
+	struct anon_page *anon_page = &page->anon;
+
+	if (!anon_page->prefetched)
+		return;
+
+	lock_acquire (&swap_lock);
+	bitmap_reset (swap_bitmap, anon_page->swap_index);
+	anon_page->swap_index = -1;
+	anon_page->prefetched = false;
+	ra_hit_cnt++;
+	if (ra_window < RA_WINDOW_MAX)
+		ra_window++;
+	lock_release (&swap_lock);
+}
+
+/* Swap in the page by read contents from the compressed pool or the
+ * swap disk.  For the disk, neighbouring virtual pages of the same
+ * process whose contents sit in the following swap slots are read with
+ * the same request, up to the readahead window, and left resident but
+ * unmapped. */
 static bool
 anon_swap_in (struct page *page, void *kva) {
 	struct anon_page *anon_page = &page->anon;
+	struct page *ra_pages[SWAP_CLUSTER_MAX];
+	struct frame *ra_frames[SWAP_CLUSTER_MAX];
+	size_t ra, found, window, i;
+	int64_t start;
+	int idx;
 
-	int idx = anon_page->swap_index;
-	
-	if(bitmap_test(swap_bitmap, idx) == false){
+	lock_acquire (&swap_lock);
+	if (anon_page->zswap != NULL) {
+		start = timer_ticks ();
+		zswap_load (page, kva);
+		pool_in_cnt++;
+		pool_in_ticks += timer_elapsed (start);
+		lock_release (&swap_lock);
+		return true;
+	}
+	/* Only the owner moves a page that is on the swap disk, so IDX
+	 * stays valid after the lock is dropped. */
+	idx = anon_page->swap_index;
+	lock_release (&swap_lock);
+	if (idx == -1 || !bitmap_test(swap_bitmap, idx))
 		return false;
+
+	/* Frames come from the free pool only: readahead never evicts.
+	 * The candidates are checked again under SWAP_LOCK, since the pool
+	 * may write one of them back to the swap disk meanwhile.  madvise()
+	 * overrides the adaptive window.  Fork reads a parent's page in from
+	 * the child, whose page table holds no neighbours of it. */
+	if (page->advice == MADV_RANDOM || page->owner != thread_current ())
+		window = 0;
+	else if (page->advice == MADV_SEQUENTIAL)
+		window = RA_WINDOW_MAX;
+	else
+		window = ra_window;
+	for (found = 0; found < window; found++) {
+		struct page *p = spt_find_page (&thread_current ()->spt,
+				page->va + (found + 1) * PGSIZE);
+		if (p == NULL || p->operations != &anon_ops || p->frame != NULL
+				|| p->anon.swap_index != idx + (int) found + 1)
+			break;
+		ra_frames[found] = vm_get_free_frame ();
+		if (ra_frames[found] == NULL)
+			break;
+		ra_pages[found] = p;
 	}
 
-	for ( int i = 0 ; i < 8 ; i ++){
-		disk_read(swap_disk, idx * 8 + i, kva+(512*i)); // ptr..?
+	lock_acquire (&swap_lock);
+	for (ra = 0; ra < found; ra++)
+		if (ra_pages[ra]->anon.swap_index != idx + (int) ra + 1)
+			break;
+	start = timer_ticks ();
+	if (ra == 0)
+		disk_read_multi (swap_disk, idx * SECTORS_PER_SLOT, SECTORS_PER_SLOT, kva);
+	else {
+		disk_read_multi (swap_disk, idx * SECTORS_PER_SLOT,
+				(ra + 1) * SECTORS_PER_SLOT, swap_cluster_buf);
+		memcpy (kva, swap_cluster_buf, PGSIZE);
+		for (i = 0; i < ra; i++) {
+			memcpy (ra_frames[i]->kva, swap_cluster_buf + (i + 1) * PGSIZE,
+					PGSIZE);
+			ra_pages[i]->anon.prefetched = true;
+		}
+		ra_cnt += ra;
 	}
-	bitmap_set(swap_bitmap, idx, 0);
+	bitmap_reset (swap_bitmap, idx);
+	swap_in_cnt++;
+	swap_in_ticks += timer_elapsed (start);
+	lock_release (&swap_lock);
+	anon_page->swap_index = -1;
+
+	for (i = 0; i < ra; i++)
+		vm_attach_frame (ra_pages[i], ra_frames[i]);
+	for (; i < found; i++)
+		vm_release_frame (ra_frames[i]);
 	
 	return true;
 }
 
+/* Writes PAGE, whose contents are at KVA, to a free swap slot on its
+ * own.  The compressed pool uses it to write back its coldest entries.
+ * Returns false if the swap disk is full.
+ * Must be called with SWAP_LOCK held. */
+bool
+anon_swap_write_page (struct page *page, const void *kva) {
+	size_t slot;
+
+	ASSERT (lock_held_by_current_thread (&swap_lock));
+
+	slot = swap_slot_alloc (1);
+	if (slot == BITMAP_ERROR)
+		return false;
+	disk_write_multi (swap_disk, slot * SECTORS_PER_SLOT, SECTORS_PER_SLOT, kva);
+	swap_out_writes++;
+	page->anon.swap_index = slot;
+	return true;
+}
+
+/* Swaps out the CNT resident anonymous pages in PAGES, whose frames the
+ * caller has pinned and unmapped, so that the owners cannot modify a
+ * page after its contents have been copied out.  Each page is stored in the compressed pool if it
+ * compresses well; the rest are placed in as few runs of contiguous
+ * swap slots as the swap space allows, and each run is written with a
+ * single multi-sector request.  Returns the number of pages swapped out,
+ * always a prefix of PAGES; fewer than CNT means the swap disk is full. */
+size_t
+anon_swap_out_cluster (struct page *pages[], size_t cnt) {
+	struct page *disk[SWAP_CLUSTER_MAX];
+	size_t disk_idx[SWAP_CLUSTER_MAX];
+	size_t disk_cnt = 0, disk_done = 0, done, i;
+	int64_t start;
+
+	ASSERT (cnt > 0 && cnt <= SWAP_CLUSTER_MAX);
+
+	lock_acquire (&swap_lock);
+	start = timer_ticks ();
+
+	/* A page that readahead brought in and nobody touched still has an
+	 * up-to-date swap slot, so it needs no I/O at all. */
+	for (i = 0; i < cnt; i++) {
+		struct page *page = pages[i];
+
+		if (page->anon.prefetched)
+			continue;
+		if (!zswap_store (page, page->frame->kva)) {
+			disk[disk_cnt] = page;
+			disk_idx[disk_cnt++] = i;
+		}
+	}
+
+	while (disk_done < disk_cnt) {
+		size_t n = disk_cnt - disk_done, slot;
+		const void *buf;
+
+		/* Shrink the run until it fits in the free swap space. */
+		while ((slot = swap_slot_alloc (n)) == BITMAP_ERROR && n > 1)
+			n /= 2;
+		if (slot == BITMAP_ERROR)
+			break;
+
+		if (n == 1)
+			buf = disk[disk_done]->frame->kva;
+		else {
+			for (i = 0; i < n; i++)
+				memcpy (swap_cluster_buf + i * PGSIZE,
+						disk[disk_done + i]->frame->kva, PGSIZE);
+			buf = swap_cluster_buf;
+		}
+		disk_write_multi (swap_disk, slot * SECTORS_PER_SLOT,
+				n * SECTORS_PER_SLOT, buf);
+		swap_out_writes++;
+
+		for (i = 0; i < n; i++)
+			disk[disk_done + i]->anon.swap_index = slot + i;
+		disk_done += n;
+	}
+	done = disk_done < disk_cnt ? disk_idx[disk_done] : cnt;
+
+	/* Pages past the first one that did not fit stay resident: drop
+	 * whatever copies of them were made. */
+	for (i = 0; i < cnt; i++) {
+		struct anon_page *anon_page = &pages[i]->anon;
+
+		if (i < done) {
+			if (anon_page->prefetched)
+				readahead_miss (pages[i]);
+			continue;
+		}
+		if (anon_page->prefetched)
+			continue;
+		if (anon_page->zswap != NULL)
+			zswap_invalidate (pages[i]);
+		if (anon_page->swap_index != -1) {
+			bitmap_reset (swap_bitmap, anon_page->swap_index);
+			anon_page->swap_index = -1;
+		}
+	}
+	swap_out_cnt += done;
+	swap_out_ticks += timer_elapsed (start);
+	lock_release (&swap_lock);
+
+	return done;
+}
+
 /* Swap out the page by writing contents to the swap disk. */
 static bool
 anon_swap_out (struct page *page) {
-	struct anon_page *anon_page = &page->anon;
-
-	// bitmap_scan으로 idx구하기
-	size_t idx = bitmap_scan(swap_bitmap, 0, 1, 0); // ★★★ (기존) disk_size(swap_disk)/8
-	if ( idx == BITMAP_ERROR ) 
-		return false;
+	pml4_clear_page (page->frame->owner->pml4, page->va);
+	return anon_swap_out_cluster (&page, 1) == 1;
+}
 
+/* Writes the page at KVA, which belongs to no page, to a free swap
+ * slot of its own and returns the slot, or -1 if the swap disk is full.
+ * Same-page merging evicts merged frames this way. */
+int
+anon_swap_write_frame (const void *kva) {
+	size_t slot;
 
-	// 디스크에 write하기
-	for ( int i = 0 ; i < 8 ; i ++){
-		disk_write(swap_disk, (idx*8)+i, page->va+(512*i)); // ★★★ page->frame->kva+(512*i)
+	lock_acquire (&swap_lock);
+	slot = swap_slot_alloc (1);
+	if (slot != BITMAP_ERROR) {
+		disk_write_multi (swap_disk, slot * SECTORS_PER_SLOT,
+				SECTORS_PER_SLOT, kva);
+		swap_out_cnt++;
+		swap_out_writes++;
 	}
+	lock_release (&swap_lock);
+	return slot != BITMAP_ERROR ? (int) slot : -1;
+}
 
-	// bitmap 업데이트
-	bitmap_set(swap_bitmap, idx, 1);
-	// swap_slot 업데이트
-	// page->swap_slot = idx; -> ★★★
-	
-	pml4_clear_page(thread_current()->pml4, page->va);
-	anon_page->swap_index = idx;
-	
-	return true;
+/* Reads swap slot SLOT, written by anon_swap_write_frame(), into KVA
+ * and frees it. */
+void
+anon_swap_read_frame (int slot, void *kva) {
+	lock_acquire (&swap_lock);
+	disk_read_multi (swap_disk, slot * SECTORS_PER_SLOT, SECTORS_PER_SLOT, kva);
+	bitmap_reset (swap_bitmap, slot);
+	swap_in_cnt++;
+	lock_release (&swap_lock);
+}
+
+/* Frees swap slot SLOT, written by anon_swap_write_frame(), unread. */
+void
+anon_swap_free_frame (int slot) {
+	lock_acquire (&swap_lock);
+	bitmap_reset (swap_bitmap, slot);
+	lock_release (&swap_lock);
 }
 
 /* Destroy the anonymous page. PAGE will be freed by the caller. */
 static void
 anon_destroy (struct page *page) {
 	struct anon_page *anon_page = &page->anon;
+
+	if (anon_page->text != NULL) {
+		text_release_page (page);
+		return;
+	}
+	if (anon_page->zero) {
+		pml4_clear_page (thread_current ()->pml4, page->va);
+		return;
+	}
+	vm_free_anon_frame (page);
+
+	/* The pool may move the page from memory to disk until we hold
+	 * SWAP_LOCK. */
+	lock_acquire (&swap_lock);
+	if (anon_page->zswap != NULL)
+		zswap_invalidate (page);
+	if (anon_page->swap_index != -1) {
+		if (anon_page->prefetched)
+			readahead_miss (page);
+		bitmap_reset (swap_bitmap, anon_page->swap_index);
+		anon_page->swap_index = -1;
+	}
+	lock_release (&swap_lock);
 }
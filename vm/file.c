@@ -5,6 +5,12 @@
 #include "userprog/process.h"
 #include "threads/vaddr.h"
 #include "threads/mmu.h"
+#include "threads/malloc.h"
+#include "threads/synch.h"
+#include <round.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
 static bool file_backed_swap_in (struct page *page, void *kva);
 static bool file_backed_swap_out (struct page *page);
@@ -19,10 +25,39 @@ static const struct page_operations file_ops = {
 	.type = VM_FILE,
 };
 
+/* Most pages written back with one write call. */
+#define WRITEBACK_MAX 16
+
+/* WRITEBACK_LOCK protects WRITEBACK_BUF, which runs of consecutive dirty
+ * pages are copied into so that each run is written with one call. */
+static struct lock writeback_lock;
+static uint8_t *writeback_buf;
+
+/* Statistics. */
+static long long writeback_pages;       /* Dirty pages written back. */
+static long long writeback_writes;      /* Write calls issued for them. */
+
+/* Dirty pages gathered for writeback. */
+struct writeback {
+	struct page **pages;        /* Gathered pages, frames pinned. */
+	size_t cnt;                 /* Number of gathered pages. */
+	size_t cap;                 /* Capacity of PAGES. */
+	struct page *one;           /* PAGES, if allocating it failed. */
+	uint64_t *pml4;             /* Page table that maps the pages. */
+};
+
 /* The initializer of file vm */
 void
 vm_file_init (void) {
+	lock_init (&writeback_lock);
+	writeback_buf = palloc_get_multiple (PAL_ASSERT, WRITEBACK_MAX);
+}
 
+/* Prints file mapping statistics. */
+void
+file_print_stats (void) {
+	printf ("Mmap writeback: %lld pages in %lld writes\n",
+			writeback_pages, writeback_writes);
 }
 
 /* Initialize the file backed page */
@@ -32,31 +67,215 @@ file_backed_initializer (struct page *page, enum vm_type type, void *kva) {
 	page->operations = &file_ops;
 
 	struct file_page *file_page = &page->file;
+	return true;
 }
 
 /* Swap in the page by read contents from the file. */
 static bool
 file_backed_swap_in (struct page *page, void *kva) {
-	struct file_page *file_page UNUSED = &page->file;
+	struct file_page *file_page = &page->file;
+
+	if (file_read_at (file_page->file, kva, file_page->page_read_bytes,
+				file_page->offset) != (int) file_page->page_read_bytes)
+		return false;
+	memset (kva + file_page->page_read_bytes, 0,
+			PGSIZE - file_page->page_read_bytes);
+	return true;
 }
 
-/* Swap out the page by writeback contents to the file. */
+/* Swap out the page by writeback contents to the file.
+ * Clean pages are simply dropped; they are read again on the next
+ * fault. */
 static bool
 file_backed_swap_out (struct page *page) {
-	struct file_page *file_page UNUSED = &page->file;
+	struct file_page *file_page = &page->file;
+	uint64_t *pml4 = page->frame->owner->pml4;
+
+	pml4_clear_page (pml4, page->va);
+	if (pml4_is_dirty (pml4, page->va)) {
+		file_write_at (file_page->file, page->frame->kva,
+				file_page->page_read_bytes, file_page->offset);
+		pml4_set_dirty (pml4, page->va, false);
+		writeback_pages++;
+		writeback_writes++;
+	}
+	return true;
 }
 
-/* Destory the file backed page. PAGE will be freed by the caller. */
+/* Destory the file backed page. PAGE will be freed by the caller.
+ * Callers that tear down many pages write them back beforehand in
+ * sorted batches (see file_backed_teardown()), so this normally finds
+ * the page clean. */
 static void
 file_backed_destroy (struct page *page) {
 	struct file_page *file_page UNUSED = &page->file;
+	struct frame *frame;
 
+	/* Pinned, so that eviction cannot write the frame back and hand it
+	 * to someone else underneath us. */
+	frame = vm_pin_page (page);
+	if (frame == NULL)
+		return;
 	if (pml4_is_dirty(thread_current()->pml4, page->va)){ // 접근 했으면 다시 써야됨!	
-		file_write_at(file_page->file, page->va, file_page->page_read_bytes, file_page->offset);
+		file_write_at(file_page->file, frame->kva, file_page->page_read_bytes, file_page->offset);
 		pml4_set_dirty(thread_current()->pml4, page->va, 0);
+		writeback_pages++;
+		writeback_writes++;
+	}
+	vm_free_frame (frame);
+}
+
+/* Returns the file PAGE, a page of a file mapping, maps. */
+static struct file *
+mapped_file (struct page *page) {
+	if (VM_TYPE (page->operations->type) == VM_UNINIT)
+		return ((struct lazy_load_file *) page->uninit.aux)->file;
+	return page->file.file;
+}
+
+/* Returns the offset in its file of PAGE, a page of a file mapping. */
+static off_t
+mapped_ofs (struct page *page) {
+	if (VM_TYPE (page->operations->type) == VM_UNINIT)
+		return ((struct lazy_load_file *) page->uninit.aux)->ofs;
+	return page->file.offset;
+}
+
+/* Orders file-backed pages by file, then by offset within the file. */
+static int
+writeback_cmp (const void *a_, const void *b_) {
+	const struct file_page *a = &(*(struct page **) a_)->file;
+	const struct file_page *b = &(*(struct page **) b_)->file;
+	struct inode *ia = file_get_inode (a->file);
+	struct inode *ib = file_get_inode (b->file);
+
+	if (ia != ib)
+		return ia < ib ? -1 : 1;
+	return a->offset < b->offset ? -1 : a->offset > b->offset;
+}
+
+/* Writes back the pages gathered in WB, sorted by file and offset, with
+ * one write call per run of consecutive pages, and unpins them. */
+static void
+writeback_flush (struct writeback *wb) {
+	uint64_t *pml4 = wb->pml4;
+	size_t i = 0;
+
+	qsort (wb->pages, wb->cnt, sizeof *wb->pages, writeback_cmp);
+	lock_acquire (&writeback_lock);
+	while (i < wb->cnt) {
+		struct file_page *first = &wb->pages[i]->file;
+		size_t n, bytes = 0;
+
+		for (n = 0; i + n < wb->cnt && n < WRITEBACK_MAX; n++) {
+			struct page *page = wb->pages[i + n];
+			struct file_page *file_page = &page->file;
+
+			if (n > 0 && (bytes % PGSIZE != 0
+						|| file_get_inode (file_page->file) != file_get_inode (first->file)
+						|| file_page->offset != first->offset + (off_t) bytes))
+				break;
+
+			/* Clear the dirty bit before copying, so that a write
+			 * after the copy dirties the page again. */
+			pml4_set_dirty (pml4, page->va, false);
+			memcpy (writeback_buf + bytes, page->frame->kva,
+					file_page->page_read_bytes);
+			bytes += file_page->page_read_bytes;
+		}
+		file_write_at (first->file, writeback_buf, bytes, first->offset);
+		writeback_pages += n;
+		writeback_writes++;
+		i += n;
+	}
+	lock_release (&writeback_lock);
+
+	for (i = 0; i < wb->cnt; i++)
+		vm_unpin_frame (wb->pages[i]->frame);
+	wb->cnt = 0;
+}
+
+/* Initializes WB to gather up to CAP pages, mapped by PML4, before
+ * writing. */
+static void
+writeback_init (struct writeback *wb, size_t cap, uint64_t *pml4) {
+	wb->pages = cap > 0 ? malloc (cap * sizeof *wb->pages) : NULL;
+	wb->cap = cap;
+	if (wb->pages == NULL) {
+		wb->pages = &wb->one;
+		wb->cap = 1;
+	}
+	wb->cnt = 0;
+	wb->pml4 = pml4;
+}
+
+/* Adds PAGE to WB if it is a resident file-backed page whose dirty bit
+ * is set in WB's page table. */
+static void
+writeback_add (struct writeback *wb, struct page *page) {
+	struct frame *frame;
+
+	if (VM_TYPE (page->operations->type) != VM_FILE)
+		return;
+	frame = vm_pin_page (page);
+	if (frame == NULL)
+		return;
+	if (!pml4_is_dirty (wb->pml4, page->va)) {
+		vm_unpin_frame (frame);
+		return;
 	}
-	pml4_clear_page(thread_current()->pml4, page->va);
+	if (wb->cnt == wb->cap)
+		writeback_flush (wb);
+	wb->pages[wb->cnt++] = page;
+}
+
+/* Writes back what is left in WB and frees it. */
+static void
+writeback_finish (struct writeback *wb) {
+	writeback_flush (wb);
+	if (wb->pages != &wb->one)
+		free (wb->pages);
 }
+
+/* Writes back the dirty pages among the CNT pages of thread T starting
+ * at ADDR. */
+static void
+sync_range (struct thread *t, void *addr, size_t cnt) {
+	struct supplemental_page_table *spt = &t->spt;
+	struct writeback wb;
+	size_t i;
+
+	writeback_init (&wb, cnt, t->pml4);
+	for (i = 0; i < cnt; i++) {
+		struct page *page = spt_find_page (spt, addr + i * PGSIZE);
+		if (page != NULL)
+			writeback_add (&wb, page);
+	}
+	writeback_finish (&wb);
+}
+
+/* Called before the SPT is destroyed: writes back every dirty mapped
+ * page in a single sorted pass and closes the files of the mappings. */
+void
+file_backed_teardown (struct supplemental_page_table *spt) {
+	struct writeback wb;
+	struct hash_iterator i;
+
+	writeback_init (&wb, hash_size (&spt->table), thread_current ()->pml4);
+	hash_first (&i, &spt->table);
+	while (hash_next (&i))
+		writeback_add (&wb, hash_entry (hash_cur (&i), struct page, hash_elem));
+	writeback_finish (&wb);
+
+	/* Nothing is written through the files from here on. */
+	hash_first (&i, &spt->table);
+	while (hash_next (&i)) {
+		struct page *page = hash_entry (hash_cur (&i), struct page, hash_elem);
+		if (page_get_type (page) == VM_FILE && page->seq_num > 0)
+			file_close (mapped_file (page));
+	}
+}
+
 /* Do the mmap */
 // 06.27
 void *
@@ -92,18 +311,56 @@ do_mmap (void *addr, size_t length, int writable,
 	return result;
 }
 
+/* Recreates in the current process the mapping whose first page is
+ * FIRST, a page of the parent being forked, on a file of its own.
+ * The child's pages are loaded from the file again, so the parent's
+ * dirty pages in the mapping are written back first; their dirty bits
+ * are in the parent's page table, not the current one. */
+bool
+do_mmap_copy (struct page *first) {
+	sync_range (thread_current ()->parent, first->va, first->seq_num);
+	return do_mmap (first->va, first->seq_num * PGSIZE, first->writable,
+			mapped_file (first), mapped_ofs (first)) != NULL;
+}
+
 /* Do the munmap */
 void
 do_munmap (void *addr) {
-	int temp = 0;
-	struct page *page = spt_find_page(&thread_current()->spt, addr);
-	while (page->seq_num-temp != 0){
+	struct supplemental_page_table *spt = &thread_current ()->spt;
+	struct page *page = spt_find_page (spt, addr);
+	struct file *file;
+	size_t cnt, i;
+
+	if (page == NULL || page->seq_num == 0)
+		return;
+	cnt = page->seq_num;
 
-	struct page *page = spt_find_page(&thread_current()->spt, addr);
+	/* Anonymous mappings (see vm_mmap_anon()) have nothing to write
+	 * back. */
+	file = NULL;
+	if (page_get_type (page) == VM_FILE) {
+		file = mapped_file (page);
+		sync_range (thread_current (), addr, cnt);
+	} else if (page_get_type (page) != VM_ANON)
+		return;
 
-	if (page == NULL && page->operations->type != VM_FILE) break;
-	file_backed_destroy(page);
-	addr += PGSIZE;
-	temp++;
+	for (i = 0; i < cnt; i++) {
+		page = spt_find_page (spt, addr + i * PGSIZE);
+		if (page != NULL)
+			spt_remove_page (spt, page);
 	}
-}
\ No newline at end of file
+	if (file != NULL)
+		file_close (file);
+}
+
+/* Writes back the dirty pages of file mappings in the LENGTH bytes
+ * starting at ADDR, which must be page-aligned.  Returns 0 on success,
+ * -1 if the range is invalid. */
+int
+do_msync (void *addr, size_t length) {
+	if (pg_ofs (addr) != 0 || addr == NULL || !is_user_vaddr (addr)
+			|| !is_user_vaddr (addr + length) || addr + length < addr)
+		return -1;
+	sync_range (thread_current (), addr, DIV_ROUND_UP (length, PGSIZE));
+	return 0;
+}
@@ -0,0 +1,247 @@
+/* text.c: Cache of read-only executable pages shared between processes.
+ *
+ * Every process running the same executable maps the same frame for
+ * each page of its read-only PT_LOAD segments.  Entries are keyed by the
+ * executable's inode and the page's file offset and are reference
+ * counted by the pages sharing them; the last reference frees the entry
+ * and its frame.  The frame is evicted like any other: the clock unmaps
+ * it from every page on its mappers list and clears the entry's frame,
+ * and the next page to fault on the entry reads it from the executable
+ * again.  Each entry keeps its inode open with writes denied, so the
+ * executable cannot change under the cache even after the process that
+ * loaded it has closed it. */
+
+#include "vm/text.h"
+#include "vm/vm.h"
+#include "filesys/file.h"
+#include "filesys/inode.h"
+#include "threads/malloc.h"
+#include "threads/mmu.h"
+#include "threads/synch.h"
+#include "userprog/process.h"
+#include <stdio.h>
+#include <string.h>
+
+/* A shared read-only page of an executable. */
+struct text_page {
+	struct hash_elem elem;      /* Element in TEXT_PAGES. */
+	struct inode *inode;        /* Executable. */
+	off_t ofs;                  /* File offset of the page. */
+	size_t read_bytes;          /* Bytes read from file, rest zeroed. */
+	struct frame *frame;        /* Shared frame, NULL if evicted. */
+	int ref_cnt;                /* Number of pages sharing it. */
+};
+
+/* TEXT_LOCK protects TEXT_PAGES and every entry's reference count, and
+ * is held while an entry is read in, so that processes faulting on it
+ * at once read it only once.  Eviction clears an entry's FRAME under
+ * the frame table's lock, so FRAME is only used through
+ * vm_map_shared_page() and friends. */
+static struct hash text_pages;
+static struct lock text_lock;
+
+/* Statistics. */
+static long long text_hit_cnt;          /* Faults served from the cache. */
+static long long text_load_cnt;         /* Pages read into the cache. */
+static long long text_copy_cnt;         /* Private copies for mlock(). */
+
+static uint64_t
+text_hash (const struct hash_elem *e, void *aux UNUSED) {
+	const struct text_page *tp = hash_entry (e, struct text_page, elem);
+	return hash_bytes (&tp->inode, sizeof tp->inode) ^ hash_int (tp->ofs);
+}
+
+static bool
+text_less (const struct hash_elem *a_, const struct hash_elem *b_,
+		void *aux UNUSED) {
+	const struct text_page *a = hash_entry (a_, struct text_page, elem);
+	const struct text_page *b = hash_entry (b_, struct text_page, elem);
+
+	if (a->inode != b->inode)
+		return a->inode < b->inode;
+	if (a->ofs != b->ofs)
+		return a->ofs < b->ofs;
+	return a->read_bytes < b->read_bytes;
+}
+
+/* Initializes the shared text cache. */
+void
+vm_text_init (void) {
+	hash_init (&text_pages, text_hash, text_less, NULL);
+	lock_init (&text_lock);
+}
+
+/* Prints text cache statistics. */
+void
+text_print_stats (void) {
+	printf ("Text cache: %lld hits, %lld loads, %lld private copies\n",
+			text_hit_cnt, text_load_cnt, text_copy_cnt);
+}
+
+/* Returns the cache entry for the page described by AUX with a new
+ * reference taken, creating it, with no frame yet, if it is not
+ * cached.  Returns NULL if memory runs out. */
+static struct text_page *
+text_get (struct lazy_load_file *aux) {
+	struct text_page key, *tp;
+	struct hash_elem *e;
+
+	key.inode = file_get_inode (aux->file);
+	key.ofs = aux->ofs;
+	key.read_bytes = aux->page_read_bytes;
+
+	lock_acquire (&text_lock);
+	e = hash_find (&text_pages, &key.elem);
+	if (e != NULL) {
+		tp = hash_entry (e, struct text_page, elem);
+		tp->ref_cnt++;
+	} else {
+		tp = malloc (sizeof *tp);
+		if (tp != NULL) {
+			*tp = key;
+			tp->frame = NULL;
+			tp->ref_cnt = 1;
+			inode_reopen (tp->inode);
+			inode_deny_write (tp->inode);
+			hash_insert (&text_pages, &tp->elem);
+		}
+	}
+	lock_release (&text_lock);
+	return tp;
+}
+
+/* Drops a reference to TP, freeing it and its frame with the last. */
+static void
+text_put (struct text_page *tp) {
+	lock_acquire (&text_lock);
+	if (--tp->ref_cnt == 0) {
+		hash_delete (&text_pages, &tp->elem);
+		inode_allow_write (tp->inode);
+		inode_close (tp->inode);
+		vm_free_shared_frame (&tp->frame);
+		free (tp);
+	}
+	lock_release (&text_lock);
+}
+
+/* Reads the contents of TP from the executable into KVA. */
+static bool
+text_read (struct text_page *tp, void *kva) {
+	if (inode_read_at (tp->inode, kva, tp->read_bytes, tp->ofs)
+			!= (off_t) tp->read_bytes)
+		return false;
+	memset (kva + tp->read_bytes, 0, PGSIZE - tp->read_bytes);
+	return true;
+}
+
+/* Maps PAGE, a shared text page of the current process, to the frame of
+ * its entry, reading the entry in first if it has no frame yet or its
+ * frame was evicted.  The frame is taken before TEXT_LOCK, since taking
+ * one may evict and so wait for I/O. */
+bool
+text_fault_in (struct page *page) {
+	struct text_page *tp = page->anon.text;
+	struct frame *frame;
+	bool success;
+
+	if (vm_map_shared_page (page, &tp->frame)) {
+		text_hit_cnt++;
+		return true;
+	}
+	frame = vm_get_frame ();
+	if (frame == NULL)
+		return false;
+
+	lock_acquire (&text_lock);
+	if (vm_map_shared_page (page, &tp->frame)) {
+		/* Read in by another process meanwhile. */
+		vm_release_frame (frame);
+		text_hit_cnt++;
+		success = true;
+	} else if (text_read (tp, frame->kva)) {
+		success = vm_share_frame (frame, &tp->frame, page);
+		text_load_cnt++;
+	} else {
+		vm_release_frame (frame);
+		success = false;
+	}
+	lock_release (&text_lock);
+	return success;
+}
+
+/* Turns PAGE, an uninitialized page, into an anonymous page that shares
+ * TP, consuming a reference to TP. */
+static void
+text_init_page (struct page *page, struct text_page *tp) {
+	struct uninit_page *uninit = &page->uninit;
+
+	/* The contents come from the cache, so the lazy initializer is not
+	 * run. */
+	uninit->page_initializer (page, uninit->type, NULL);
+	page->anon.text = tp;
+}
+
+/* Claims PAGE, a read-only page of an executable that
+ * lazy_load_segment() would fill as described by AUX, by mapping the
+ * shared copy of it. */
+bool
+text_claim_page (struct page *page, struct lazy_load_file *aux) {
+	struct text_page *tp = text_get (aux);
+
+	if (tp == NULL)
+		return false;
+	text_init_page (page, tp);
+	return text_fault_in (page);
+}
+
+/* Makes PAGE, an uninitialized page of the current process, share TP.
+ * Used by fork to copy a parent's shared text page.  If TP's frame is
+ * evicted, the page is mapped on its first fault. */
+bool
+text_share_page (struct page *page, struct text_page *tp) {
+	lock_acquire (&text_lock);
+	tp->ref_cnt++;
+	lock_release (&text_lock);
+	text_init_page (page, tp);
+	vm_map_shared_page (page, &tp->frame);
+	return true;
+}
+
+/* Gives PAGE, a shared text page of the current process, a private
+ * copy of its contents, read from the executable into a frame of its
+ * own, and drops its reference.  Used by mlock(), so that locking the
+ * page pins no frame that other processes map. */
+bool
+text_unshare_page (struct page *page) {
+	struct text_page *tp = page->anon.text;
+	struct frame *frame = vm_get_frame ();
+
+	if (frame == NULL)
+		return false;
+	if (!text_read (tp, frame->kva)) {
+		vm_release_frame (frame);
+		return false;
+	}
+	text_release_page (page);
+	if (!pml4_set_page (thread_current ()->pml4, page->va, frame->kva,
+				false)) {
+		vm_release_frame (frame);
+		return false;
+	}
+	page->anon.file_data = true;
+	vm_attach_frame (page, frame);
+	text_copy_cnt++;
+	return true;
+}
+
+/* Unmaps PAGE, a shared text page, and drops its reference. */
+void
+text_release_page (struct page *page) {
+	struct text_page *tp = page->anon.text;
+
+	ASSERT (tp != NULL);
+
+	vm_unmap_shared_page (page, &tp->frame);
+	text_put (tp);
+	page->anon.text = NULL;
+}
@@ -10,6 +10,8 @@
 
 #include "vm/vm.h"
 #include "vm/uninit.h"
+#include "threads/vaddr.h"
+#include <string.h>
 
 static bool uninit_initialize (struct page *page, void *kva);
 static void uninit_destroy (struct page *page);
@@ -53,8 +55,14 @@ uninit_initialize (struct page *page, void *kva) {
 	void *aux = uninit->aux;
 
 	/* TODO: You may need to fix this function. */
-	return uninit->page_initializer (page, uninit->type, kva) &&
-		(init ? init (page, aux) : true);
+	if (!uninit->page_initializer (page, uninit->type, kva))
+		return false;
+	if (init != NULL)
+		return init (page, aux);
+	/* A page without contents of its own (stack, heap, anonymous
+	 * mapping) must not see what the frame held before. */
+	memset (kva, 0, PGSIZE);
+	return true;
 }
 
 /* Free the resources hold by uninit_page. Although most of pages are transmuted
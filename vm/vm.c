@@ -3,29 +3,201 @@
 #include "threads/malloc.h"
 #include "vm/vm.h"
 #include "vm/inspect.h"
+#include "vm/text.h"
 #include "threads/mmu.h"
 #include "lib/string.h"
 #include "lib/kernel/hash.h"
 #include "userprog/syscall.h"
+#include "userprog/process.h"
+#include "threads/synch.h"
+#include "devices/timer.h"
+#include <round.h>
+#include <stdio.h>
+#include <syscall-nr.h>
 
-struct list frame_table;
-// ★
-struct list_elem* start;
+/* Global frame table, one entry per user pool page and indexed by
+ * frame number.  FRAME_LOCK protects every entry and the clock hand.
+ * Eviction claims and unmaps a victim under FRAME_LOCK but drops the
+ * lock for the I/O; whoever needs the frame meanwhile waits on IO_DONE
+ * (see frame_wait_io()). */
+static struct frame *frame_table;
+static size_t frame_cnt;
+static size_t clock_hand;
+static struct lock frame_lock;
+static struct condition io_done;
+static size_t frames_used;      /* Frames taken from the user pool. */
+
+/* Background reclaim.  When an allocation leaves fewer than
+ * RECLAIM_LOW free frames, the reclaim thread is woken and evicts
+ * pages, in the same clusters as the fault path does, until
+ * RECLAIM_HIGH frames are free again.  The fault path then usually
+ * finds a free frame and evicts on its own only if the thread falls
+ * behind. */
+static size_t reclaim_low, reclaim_high;
+static struct semaphore reclaim_sema;
+static bool reclaim_pending;    /* Reclaim thread woken, not yet done. */
+
+/* A frame of zeros, mapped read-only at every anonymous page that has
+ * been read but never written.  It belongs to no page and is never
+ * freed or evicted. */
+static void *zero_kva;
+
+/* Fault-around window bounds, in pages mapped after the faulting one.
+ * The window doubles while a process faults sequentially through a
+ * file-backed region and halves when it jumps around. */
+#define FAULT_AROUND_MIN 1
+#define FAULT_AROUND_INIT 4
+#define FAULT_AROUND_MAX 16
+
+/* Page-fault-frequency frame allocation.  Each process measures its
+ * fault rate and samples its working set, the resident pages accessed
+ * since the previous sample, once every PFF_WINDOW ticks.  A process
+ * faulting more than PFF_HIGH_RATE times a second gets a larger quota,
+ * limited so that the other processes keep their working sets; one
+ * faulting less than PFF_LOW_RATE times a second has its quota cut to
+ * its working set.  When frames run out, the clock first takes frames
+ * from processes above their quota, and a process that is at its quota
+ * itself replaces its own pages.  Cleared by the -nopff option. */
+#define PFF_WINDOW (TIMER_FREQ / 4)
+#define PFF_HIGH_RATE 200
+#define PFF_LOW_RATE 20
+#define PFF_MIN_QUOTA 16
+bool vm_pff = true;
+static size_t pff_ws_total;     /* Sum of all working-set estimates. */
+
+/* Whether fully populated anonymous 2 MiB regions are promoted to
+ * huge pages.  Cleared by the -nohuge kernel option. */
+bool vm_huge_pages = true;
+
+/* Same-page merging.  When enabled with -ksm, the ksm thread wakes
+ * every KSM_INTERVAL ticks and checksums VM_KSM_SCAN_RATE frames of the
+ * frame table.  A frame whose checksum did not change since the last
+ * pass is stable: it is merged into an identical frame of STABLE_PAGES
+ * or, failing that, with an identical stable frame met earlier in the
+ * pass, which is remembered in UNSTABLE_PAGES.  Merged frames are
+ * mapped read-only by every page that shares them; a write gives the
+ * writer a private copy.  The clock evicts a merged frame to a swap
+ * slot of its own, and the first page to fault on it reads it back.
+ * FRAME_LOCK protects both tables and every ksm_page. */
+#define KSM_INTERVAL (TIMER_FREQ / 10)
+size_t vm_ksm_scan_rate = 0;
+
+/* A frame shared by identical anonymous pages. */
+struct ksm_page {
+	struct hash_elem elem;      /* Element in STABLE_PAGES. */
+	uint64_t sum;               /* Checksum of the contents. */
+	struct frame *frame;        /* Shared frame, NULL if evicted. */
+	int swap_index;             /* Swap slot while evicted. */
+	bool stable;                /* In STABLE_PAGES. */
+	int ref_cnt;                /* Number of pages sharing it. */
+};
+
+/* A stable frame not merged yet, seen in the current pass. */
+struct ksm_candidate {
+	struct hash_elem elem;      /* Element in UNSTABLE_PAGES. */
+	uint64_t sum;               /* Checksum of the contents. */
+	struct frame *frame;
+	struct page *page;          /* FRAME's page when it was seen. */
+};
+
+static struct hash stable_pages;
+static struct hash unstable_pages;
+static size_t ksm_cursor;
+
+/* Statistics. */
+static long long fault_cnt;             /* Faults handled by the VM. */
+static long long fault_around_cnt;      /* Pages mapped by fault-around. */
+static long long huge_cnt;              /* Regions promoted to huge pages. */
+static long long huge_fail_cnt;         /* ...that fell back to 4 KiB. */
+static long long zero_map_cnt;          /* Pages mapped to the zero frame. */
+static long long zero_cow_cnt;          /* ...later given a frame on write. */
+static long long evict_cnt;             /* Frames evicted. */
+static long long evict_dirty_cnt;       /* ...of which were dirty. */
+static long long reclaim_wake_cnt;      /* Reclaim thread wakeups. */
+static long long reclaim_cnt;           /* Frames it freed. */
+static long long direct_reclaim_cnt;    /* Evictions by faulting threads. */
+static long long pff_raise_cnt;         /* Quotas raised. */
+static long long pff_cut_cnt;           /* Quotas cut to the working set. */
+static long long pff_evict_cnt;         /* Victims taken by quota. */
+static long long prefetch_cnt;          /* Pages brought in by WILLNEED. */
+static long long dontneed_cnt;          /* Pages dropped by DONTNEED. */
+static long long locked_cnt;            /* Pages locked by mlock(). */
+static long long ksm_merge_cnt;         /* Pages merged. */
+static long long ksm_unshare_cnt;       /* ...later copied on write. */
+static long long ksm_shared;            /* Pages mapping a merged frame. */
+static long long ksm_frames;            /* Merged frames. */
+
+/* Fault latency histogram: bucket 0 counts faults handled within the
+ * tick they started in, bucket I > 0 faults that took 2^(I-1) to
+ * 2^I - 1 ticks, and the last bucket all slower faults. */
+#define FAULT_LATENCY_BUCKETS 6
+static long long fault_latency[FAULT_LATENCY_BUCKETS];
+
+static void reclaim_thread (void *aux);
+static void ksm_init (void);
 
 /* Initializes the virtual memory subsystem by invoking each subsystem's
  * intialize codes. */
 void
 vm_init (void) {
+	size_t i;
+
 	vm_anon_init ();
 	vm_file_init ();
+	vm_text_init ();
 #ifdef EFILESYS  /* For project 4 */
 	pagecache_init ();
 #endif
 	register_inspect_intr ();
 	/* DO NOT MODIFY UPPER LINES. */
 	/* TODO: Your code goes here. */
-	list_init(&frame_table); // 6.30
-	start = list_begin(&frame_table);
+	frame_cnt = palloc_user_page_cnt ();
+	frame_table = calloc (frame_cnt, sizeof *frame_table);
+	if (frame_table == NULL)
+		PANIC ("frame table allocation failed");
+	for (i = 0; i < frame_cnt; i++)
+		list_init (&frame_table[i].mappers);
+	clock_hand = 0;
+	lock_init (&frame_lock);
+	cond_init (&io_done);
+	zero_kva = palloc_get_page (PAL_ASSERT | PAL_ZERO);
+
+	reclaim_low = frame_cnt / 64 > SWAP_CLUSTER_MAX
+		? frame_cnt / 64 : SWAP_CLUSTER_MAX;
+	reclaim_high = 2 * reclaim_low;
+	sema_init (&reclaim_sema, 0);
+	thread_create ("reclaim", PRI_DEFAULT, reclaim_thread, NULL);
+	ksm_init ();
+}
+
+/* Prints virtual memory statistics. */
+void
+vm_print_stats (void) {
+	printf ("VM: %lld faults, %lld evictions (%lld dirty)\n",
+			fault_cnt, evict_cnt, evict_dirty_cnt);
+	printf ("Fault latency: %lld in 0 ticks, %lld in 1, %lld in 2-3, "
+			"%lld in 4-7, %lld in 8-15, %lld in 16+\n",
+			fault_latency[0], fault_latency[1], fault_latency[2],
+			fault_latency[3], fault_latency[4], fault_latency[5]);
+	printf ("Reclaim: %lld wakeups, %lld frames freed in background, "
+			"%lld direct evictions\n",
+			reclaim_wake_cnt, reclaim_cnt, direct_reclaim_cnt);
+	printf ("PFF: %lld quota raises, %lld quota cuts, %lld victims by quota\n",
+			pff_raise_cnt, pff_cut_cnt, pff_evict_cnt);
+	printf ("Fault-around: %lld pages mapped\n", fault_around_cnt);
+	printf ("madvise: %lld pages prefetched, %lld pages dropped\n",
+			prefetch_cnt, dontneed_cnt);
+	printf ("KSM: %lld pages merged, %lld copied on write, "
+			"%lld pages share %lld frames (%lld KiB saved)\n",
+			ksm_merge_cnt, ksm_unshare_cnt, ksm_shared, ksm_frames,
+			(ksm_shared - ksm_frames) * PGSIZE / 1024);
+	printf ("Huge pages: %lld promoted, %lld fallbacks\n",
+			huge_cnt, huge_fail_cnt);
+	printf ("Zero page: %lld pages mapped, %lld written\n",
+			zero_map_cnt, zero_cow_cnt);
+	anon_print_stats ();
+	text_print_stats ();
+	file_print_stats ();
 }
 
 /* Get the type of the page. This function is useful if you want to know the
@@ -44,8 +216,17 @@ page_get_type (struct page *page) {
 
 /* Helpers */
 static struct frame *vm_get_victim (void);
+static struct frame *clock_sweep (bool by_quota);
 static bool vm_do_claim_page (struct page *page);
 static struct frame *vm_evict_frame (void);
+static void frame_link (struct frame *frame, struct page *page);
+static void frame_release (struct frame *frame);
+static bool vm_map_resident_page (struct page *page);
+static bool vm_ksm_page (struct page *page);
+static bool vm_text_page (struct page *page);
+static bool vm_ksm_fault_in (struct page *page);
+static void vm_drop_behind (struct supplemental_page_table *spt, void *va);
+static void vm_page_unlocked (struct page *page);
 void hash_destroy_func(struct hash_elem *e, void* aux);
 
 /* Create the pending page object with initializer. If you want to create a
@@ -80,6 +261,7 @@ vm_alloc_page_with_initializer (enum vm_type type, void *va, bool writable,
 				return false;
 		}
 		p->writable = writable;
+		p->owner = thread_current ();
 		/* TODO: Insert the page into the spt. */
 		return spt_insert_page(spt, p);
 	}
@@ -125,104 +307,654 @@ spt_insert_page (struct supplemental_page_table *spt UNUSED,
 
 void
 spt_remove_page (struct supplemental_page_table *spt, struct page *page) {
+	hash_delete (&spt->table, &page->hash_elem);
+	vm_page_unlocked (page);
 	vm_dealloc_page (page);
-	return true;
 }
 
-/* Get the struct frame, that will be evicted. */
+/* Returns the quota of the process whose page table is SPT.  A process
+ * that has not faulted for two windows is treated as idle, with just
+ * its working set as quota. */
+static size_t
+pff_quota (struct supplemental_page_table *spt) {
+	if (timer_elapsed (spt->pff_start) > 2 * PFF_WINDOW)
+		return spt->ws;
+	return spt->quota;
+}
+
+/* Returns true if page-fault-frequency allocation prefers taking frames
+ * from thread T: T is above its quota, or T is the running thread and
+ * has reached it. */
+static bool
+pff_reclaimable (struct thread *t) {
+	struct supplemental_page_table *spt = &t->spt;
+	size_t quota = pff_quota (spt);
+
+	return spt->rss > quota || (t == thread_current () && spt->rss >= quota);
+}
+
+/* Called on every fault of the current process, whose page table is
+ * SPT: at the end of each window, samples the working set and adjusts
+ * the quota by the fault rate. */
+static void
+pff_fault (struct supplemental_page_table *spt) {
+	struct thread *t = thread_current ();
+	int64_t elapsed = timer_elapsed (spt->pff_start);
+	size_t rate, ws = 0, old_ws, cap, i;
+
+	spt->pff_faults++;
+	if (!vm_pff || elapsed < PFF_WINDOW)
+		return;
+
+	lock_acquire (&frame_lock);
+	for (i = 0; i < frame_cnt; i++) {
+		struct frame *f = &frame_table[i];
+
+		if (f->page == NULL || f->owner != t)
+			continue;
+		if (pml4_is_accessed (t->pml4, f->page->va)) {
+			pml4_set_accessed (t->pml4, f->page->va, false);
+			ws++;
+		}
+	}
+	/* Smooth the estimate over the last few windows. */
+	old_ws = spt->ws;
+	spt->ws = (spt->ws + ws + 1) / 2;
+	pff_ws_total = pff_ws_total - old_ws + spt->ws;
+
+	rate = spt->pff_faults * TIMER_FREQ / elapsed;
+	if (rate > PFF_HIGH_RATE) {
+		size_t step = spt->rss / 4 > PFF_MIN_QUOTA ? spt->rss / 4 : PFF_MIN_QUOTA;
+
+		cap = pff_ws_total - spt->ws < frame_cnt - PFF_MIN_QUOTA
+			? frame_cnt - (pff_ws_total - spt->ws) : PFF_MIN_QUOTA;
+		spt->quota = (spt->quota > spt->rss ? spt->quota : spt->rss) + step;
+		if (spt->quota > cap)
+			spt->quota = cap;
+		pff_raise_cnt++;
+	} else if (rate < PFF_LOW_RATE) {
+		spt->quota = spt->ws > PFF_MIN_QUOTA ? spt->ws : PFF_MIN_QUOTA;
+		pff_cut_cnt++;
+	}
+	lock_release (&frame_lock);
+
+	spt->pff_start = timer_ticks ();
+	spt->pff_faults = 0;
+}
+
+/* Get the struct frame, that will be evicted.
+ * Runs the clock hand over the frame table with a second-chance policy
+ * that prefers clean victims: a frame whose accessed bit is set gets its
+ * bit cleared and is skipped, an unreferenced clean frame is taken at
+ * once, and an unreferenced dirty frame is remembered and used only if a
+ * whole sweep finds nothing clean.  Accessed and dirty bits are read from
+ * the page table of the frame's owner, not of the running thread, or
+ * of every page that maps a shared frame.
+ * The clock first only considers private frames that pff_reclaimable()
+ * picks.
+ * Must be called with FRAME_LOCK held. */
 static struct frame *
 vm_get_victim (void) {
 	struct frame *victim = NULL;
-	/* TODO: The policy for eviction is up to you. */
-	struct list_elem *e = start;
-	struct thread *curr = thread_current();
-
-
-	// if (!list_empty (&frame_table)) {
-	// 	struct list_elem *e;
-	// 	for (e = list_begin (&frame_table); e != list_end (&frame_table); e = e->prev){
-	// 		struct frame *temp = list_entry(e, struct frame, frame_elem);
-	// 		if ( pml4_is_accessed(thread_current()->pml4, temp->page->va) ){
-	// 			pml4_set_accessed(thread_current()->pml4, temp->page->va, 0);
-	// 		} else {
-	// 			victim = temp;
-	// 			break;
-	// 		}
-	// 	}
-	// }
-	// if (victim == NULL){
-	// 	victim = list_entry(list_begin(&frame_table), struct frame, frame_elem);
-	// }
-	for (start = e; start != list_end(&frame_table); start = list_next(start))
-	{
-		victim = list_entry(start, struct frame, frame_elem);
-		if (pml4_is_accessed(curr->pml4, victim->page->va))
-			pml4_set_accessed(curr->pml4, victim->page->va, 0);
-		else
-			return victim;
+
+	ASSERT (lock_held_by_current_thread (&frame_lock));
+
+	if (vm_pff) {
+		victim = clock_sweep (true);
+		if (victim != NULL)
+			pff_evict_cnt++;
 	}
+	if (victim == NULL)
+		victim = clock_sweep (false);
+	return victim;
+}
 
-	for (start = list_begin(&frame_table); start != e; start = list_next(start))
-	{
-		victim = list_entry(start, struct frame, frame_elem);
-		if (pml4_is_accessed(curr->pml4, victim->page->va))
-			pml4_set_accessed(curr->pml4, victim->page->va, 0);
-		else
-			return victim;
+/* Returns true if FRAME is shared rather than private.
+ * Must be called with FRAME_LOCK held. */
+static bool
+frame_shared (struct frame *frame) {
+	return frame->ksm != NULL || frame->shared != NULL;
+}
+
+/* Returns true if FRAME was accessed since the clock last passed it,
+ * clearing the accessed bits it finds set.
+ * Must be called with FRAME_LOCK held. */
+static bool
+frame_test_accessed (struct frame *frame) {
+	struct list_elem *e;
+	bool accessed = false;
+
+	if (frame->page != NULL) {
+		uint64_t *pml4 = frame->owner->pml4;
+
+		accessed = pml4_is_accessed (pml4, frame->page->va);
+		if (accessed)
+			pml4_set_accessed (pml4, frame->page->va, false);
+		return accessed;
 	}
+	for (e = list_begin (&frame->mappers); e != list_end (&frame->mappers);
+			e = list_next (e)) {
+		struct page *page = list_entry (e, struct page, mapper_elem);
 
+		if (pml4_is_accessed (page->owner->pml4, page->va)) {
+			pml4_set_accessed (page->owner->pml4, page->va, false);
+			accessed = true;
+		}
+	}
+	return accessed;
+}
 
-	return victim;
+/* Runs the clock for vm_get_victim(), over the frames of processes
+ * that pff_reclaimable() picks only if BY_QUOTA. */
+static struct frame *
+clock_sweep (bool by_quota) {
+	struct frame *dirty = NULL;
+	size_t i;
+
+	/* The first sweep clears every accessed bit it passes, so the
+	 * second one is bound to find a candidate if any frame is unpinned.
+	 * Frames mapped by a huge page are never evicted.  Shared frames
+	 * are mapped read-only and so are always clean. */
+	for (i = 0; i < 2 * frame_cnt; i++) {
+		struct frame *f = &frame_table[clock_hand];
+
+		if (i == frame_cnt && dirty != NULL)
+			return dirty;
+		clock_hand = (clock_hand + 1) % frame_cnt;
+
+		if (f->pinned || (f->page == NULL && !frame_shared (f)))
+			continue;
+		if (by_quota && (f->page == NULL || !pff_reclaimable (f->owner)))
+			continue;
+		if (f->page != NULL && pml4_is_huge (f->owner->pml4, f->page->va))
+			continue;
+		if (frame_test_accessed (f))
+			continue;
+		if (f->page == NULL || !pml4_is_dirty (f->owner->pml4, f->page->va))
+			return f;
+		if (dirty == NULL)
+			dirty = f;
+	}
+	return dirty;
+}
+
+/* Waits while *FRAMEP, if not null, is being written out or read back.
+ * Eviction may set *FRAMEP to null meanwhile.
+ * Must be called with FRAME_LOCK held, which is released while
+ * waiting. */
+static void
+frame_wait_io (struct frame **framep) {
+	ASSERT (lock_held_by_current_thread (&frame_lock));
+
+	while (*framep != NULL && (*framep)->io)
+		cond_wait (&io_done, &frame_lock);
+}
+
+/* Unmaps FRAME, a shared frame, from every page that maps it.
+ * Must be called with FRAME_LOCK held. */
+static void
+frame_unmap_all (struct frame *frame) {
+	while (!list_empty (&frame->mappers)) {
+		struct list_elem *e = list_pop_front (&frame->mappers);
+		struct page *page = list_entry (e, struct page, mapper_elem);
+
+		pml4_clear_page (page->owner->pml4, page->va);
+	}
+}
+
+/* Returns true if PAGE maps FRAME, a shared frame that may be null,
+ * and so is on FRAME's MAPPERS.
+ * Must be called with FRAME_LOCK held. */
+static bool
+shared_mapped (struct page *page, struct frame *frame) {
+	return frame != NULL
+		&& pml4_get_page (page->owner->pml4, page->va) == frame->kva;
+}
+
+/* Maps PAGE read-only to FRAME, a resident shared frame, and adds it to
+ * FRAME's mappers, unless it maps FRAME already.  Returns false if
+ * FRAME is null or memory runs out.
+ * Must be called with FRAME_LOCK held. */
+static bool
+shared_map (struct page *page, struct frame *frame) {
+	if (frame == NULL)
+		return false;
+	if (shared_mapped (page, frame))
+		return true;
+	if (!pml4_set_page (page->owner->pml4, page->va, frame->kva, false))
+		return false;
+	list_push_back (&frame->mappers, &page->mapper_elem);
+	return true;
+}
+
+/* Claims FRAME, a private frame chosen by the clock, for eviction:
+ * pins it, marks it busy and unmaps its page, so that the owner cannot
+ * modify the page once its contents are being written out and waits
+ * for the write if it faults on the page.
+ * Must be called with FRAME_LOCK held. */
+static void
+evict_claim (struct frame *frame) {
+	uint64_t *pml4 = frame->owner->pml4;
+
+	if (pml4_is_dirty (pml4, frame->page->va))
+		evict_dirty_cnt++;
+	pml4_clear_page (pml4, frame->page->va);
+	frame->pinned = true;
+	frame->io = true;
+}
+
+/* Swaps out VICTIM, a frame holding an anonymous page, together with up
+ * to SWAP_CLUSTER_MAX - 1 further anonymous victims chosen by the clock,
+ * so that the whole cluster goes to swap in one sequential write.  The
+ * extra frames are returned to the user pool for the faults that follow.
+ * Returns true if VICTIM itself was swapped out.
+ * Must be called with FRAME_LOCK held, which is released during the
+ * write. */
+static bool
+evict_anon_cluster (struct frame *victim) {
+	struct frame *frames[SWAP_CLUSTER_MAX];
+	struct page *pages[SWAP_CLUSTER_MAX];
+	size_t cnt = 0, done, i;
+
+	evict_claim (victim);
+	frames[cnt] = victim;
+	pages[cnt++] = victim->page;
+	while (cnt < SWAP_CLUSTER_MAX) {
+		struct frame *f = vm_get_victim ();
+		if (f == NULL || f->page == NULL
+				|| VM_TYPE (f->page->operations->type) != VM_ANON)
+			break;
+		evict_claim (f);
+		frames[cnt] = f;
+		pages[cnt++] = f->page;
+	}
+
+	lock_release (&frame_lock);
+	done = anon_swap_out_cluster (pages, cnt);
+	lock_acquire (&frame_lock);
+	evict_cnt += done;
+
+	/* Pages that did not fit stay resident, unmapped until their next
+	 * fault. */
+	for (i = 0; i < cnt; i++) {
+		frames[i]->io = false;
+		if (i >= done)
+			frames[i]->pinned = false;
+		else if (i > 0)
+			frame_release (frames[i]);
+	}
+	return done > 0;
+}
+
+/* Writes VICTIM, a frame holding a page of a file mapping, back to the
+ * file if it is dirty.
+ * Must be called with FRAME_LOCK held, which is released during the
+ * write. */
+static bool
+evict_file (struct frame *victim) {
+	bool evicted;
+
+	evict_claim (victim);
+	lock_release (&frame_lock);
+	evicted = swap_out (victim->page);
+	lock_acquire (&frame_lock);
+	victim->io = false;
+	if (evicted)
+		evict_cnt++;
+	else
+		victim->pinned = false;
+	return evicted;
+}
+
+/* Evicts VICTIM, a shared text frame: unmaps it from every page that
+ * maps it and clears the text cache's slot for it.  The next fault on
+ * one of the pages reads the contents from the executable again (see
+ * text_fault_in()), so nothing needs writing.
+ * Must be called with FRAME_LOCK held. */
+static bool
+evict_text (struct frame *victim) {
+	frame_unmap_all (victim);
+	*victim->shared = NULL;
+	victim->shared = NULL;
+	evict_cnt++;
+	return true;
+}
+
+/* Writes VICTIM, a merged frame, to a swap slot of its own, after
+ * unmapping it from every page that shares it.  The first of them to
+ * fault reads it back (see vm_ksm_fault_in()).  Returns false if the
+ * swap disk is full.
+ * Must be called with FRAME_LOCK held, which is released during the
+ * write. */
+static bool
+evict_ksm (struct frame *victim) {
+	struct ksm_page *kp = victim->ksm;
+	int slot;
+
+	frame_unmap_all (victim);
+	victim->pinned = true;
+	victim->io = true;
+	lock_release (&frame_lock);
+	slot = anon_swap_write_frame (victim->kva);
+	lock_acquire (&frame_lock);
+	victim->io = false;
+	if (slot == -1) {
+		victim->pinned = false;
+		return false;
+	}
+
+	/* STABLE_PAGES compares contents, so an evicted frame leaves it. */
+	if (kp->stable) {
+		hash_delete (&stable_pages, &kp->elem);
+		kp->stable = false;
+	}
+	kp->swap_index = slot;
+	kp->frame = NULL;
+	victim->ksm = NULL;
+	evict_cnt++;
+	return true;
 }
 
 /* Evict one page and return the corresponding frame.
- * Return NULL on error.*/
+ * Return NULL on error.
+ * The victim is claimed under FRAME_LOCK, but the lock is dropped for
+ * the I/O.  The owner of a page being written out cannot tear it down
+ * meanwhile: the page destructors wait for the I/O to finish first. */
 static struct frame *
 vm_evict_frame (void) {
-	struct frame *victim = vm_get_victim ();
-	/* TODO: swap out the victim and return the evicted frame. */
-	// if ( victim == NULL ) return NULL;
+	struct frame *victim;
+	bool evicted;
+
+	lock_acquire (&frame_lock);
+	victim = vm_get_victim ();
+	if (victim == NULL)
+		goto done;
+
+	if (victim->ksm != NULL)
+		evicted = evict_ksm (victim);
+	else if (victim->shared != NULL)
+		evicted = evict_text (victim);
+	else if (VM_TYPE (victim->page->operations->type) == VM_ANON)
+		evicted = evict_anon_cluster (victim);
+	else
+		evicted = evict_file (victim);
+	cond_broadcast (&io_done, &frame_lock);
+	if (!evicted) {
+		victim = NULL;
+		goto done;
+	}
 
-	swap_out(victim->page);
+	if (victim->page != NULL) {
+		victim->page->frame = NULL;
+		victim->page = NULL;
+		victim->owner->spt.rss--;
+	}
+	victim->owner = thread_current ();
+	victim->pinned = true;
+done:
+	lock_release (&frame_lock);
 	return victim;
 }
 
 /* palloc() and get frame. If there is no available page, evict the page
  * and return it. This always return valid address. That is, if the user pool
  * memory is full, this function evicts the frame to get the available memory
- * space.*/
-// ▶ 메모리 풀에서 새로운 물리메모리 페이지를 가져온다.
-// 06.15 : 구현
-// 06.16 : 수정 1차
-static struct frame *
+ * space.
+ * The returned frame is pinned; vm_do_claim_page() unpins it once the
+ * contents are in place.  A frame that never gets a page stays pinned
+ * until vm_release_frame() or until it becomes a shared frame. */
+struct frame *
 vm_get_frame (void) {
-	struct frame *frame = (struct frame *) malloc(sizeof(struct frame));
+	struct frame *frame = vm_get_free_frame ();
 
-    /* TODO: Fill this function. */
-    // palloc_get_page()를 호출해서 새로운 물리 메모리 페이지를 가져온다.
-    // 성공 : 프레임 할당 -> 프레임 구조체의 멤버들을 초기화 한 후 -> 해당 프레임을 반환한다.
-    // 이후 모든 유저 공간 페이지들은 이 함수를 통해 할당한다.
-    // 실패 : PANIC("todo")
+	if (frame == NULL) {
+		direct_reclaim_cnt++;
+		frame = vm_evict_frame ();
+	}
+	return frame;
+}
 
-	// malloc() -> kva = palloc_get_page
-	bool is_evic = false;
+/* Wakes the reclaim thread if the user pool is below the low
+ * watermark.  Must be called with FRAME_LOCK held. */
+static void
+reclaim_check (void) {
+	ASSERT (lock_held_by_current_thread (&frame_lock));
 
-    frame->kva = palloc_get_page(PAL_USER); // 물리 프레임의 주소(kva)를 반환하는 것
-	if (frame->kva == NULL){
-        // PANIC("todo");
-		frame = vm_evict_frame(); // 6.30
+	if (!reclaim_pending && frame_cnt - frames_used < reclaim_low) {
+		reclaim_pending = true;
+		sema_up (&reclaim_sema);
+	}
+}
 
-		is_evic = true;
-    }
-	
-	if(!is_evic){ // 07.01 추가
-	list_push_back(&frame_table, &frame->frame_elem);
+/* Reclaim thread: on each wakeup, evicts frames until the high
+ * watermark is reached or nothing more can be evicted. */
+static void
+reclaim_thread (void *aux UNUSED) {
+	for (;;) {
+		sema_down (&reclaim_sema);
+		reclaim_wake_cnt++;
+
+		for (;;) {
+			struct frame *frame;
+			size_t used;
+
+			lock_acquire (&frame_lock);
+			used = frames_used;
+			lock_release (&frame_lock);
+			if (frame_cnt - used >= reclaim_high)
+				break;
+
+			frame = vm_evict_frame ();
+			if (frame == NULL)
+				break;
+			lock_acquire (&frame_lock);
+			frame_release (frame);
+			reclaim_cnt += used - frames_used;
+			lock_release (&frame_lock);
+		}
+
+		lock_acquire (&frame_lock);
+		reclaim_pending = false;
+		lock_release (&frame_lock);
+	}
+}
+
+/* Returns a pinned frame taken from the free user pool, or NULL if the
+ * pool is empty.  Never evicts, so speculative reads (readahead,
+ * fault-around) use it directly. */
+struct frame *
+vm_get_free_frame (void) {
+	struct frame *frame;
+	void *kva = palloc_get_page (PAL_USER);
+
+	lock_acquire (&frame_lock);
+	if (kva == NULL) {
+		reclaim_check ();
+		lock_release (&frame_lock);
+		return NULL;
 	}
+	frames_used++;
+	reclaim_check ();
+	frame = &frame_table[palloc_user_page_idx (kva)];
+	frame->kva = kva;
 	frame->page = NULL;
-    ASSERT (frame != NULL);
-    ASSERT (frame->page == NULL);
-	
-    return frame;
+	frame->owner = thread_current ();
+	frame->pinned = true;
+	lock_release (&frame_lock);
+
+	return frame;
+}
+
+/* Attaches FRAME, which already holds PAGE's contents, to PAGE without
+ * mapping it, and makes the frame evictable.  The next fault on PAGE
+ * just maps the frame (see vm_map_resident_page()). */
+void
+vm_attach_frame (struct page *page, struct frame *frame) {
+	lock_acquire (&frame_lock);
+	frame_link (frame, page);
+	frame->pinned = false;
+	lock_release (&frame_lock);
+}
+
+/* Pins and returns PAGE's frame so that it cannot be evicted, or
+ * returns NULL if PAGE is not resident.  If the frame is being evicted,
+ * waits until it is gone and returns NULL. */
+struct frame *
+vm_pin_page (struct page *page) {
+	struct frame *frame;
+
+	lock_acquire (&frame_lock);
+	frame_wait_io (&page->frame);
+	frame = page->frame;
+	if (frame != NULL)
+		frame->pinned = true;
+	lock_release (&frame_lock);
+	return frame;
+}
+
+/* Unpins FRAME, pinned by vm_pin_page(), unless its page is locked
+ * by mlock(). */
+void
+vm_unpin_frame (struct frame *frame) {
+	frame->pinned = frame->page != NULL && frame->page->locked;
+}
+
+/* Maps PAGE, whose contents are already resident in a frame, into the
+ * current process.  Falls back to a full claim if the frame was evicted
+ * in the meantime, or to mapping the merged frame if it was merged. */
+static bool
+vm_map_resident_page (struct page *page) {
+	struct frame *frame = vm_pin_page (page);
+	bool success;
+
+	if (frame == NULL)
+		return vm_ksm_page (page) ? vm_ksm_fault_in (page)
+			: vm_do_claim_page (page);
+
+	success = pml4_set_page (thread_current ()->pml4, page->va, frame->kva,
+			page->writable);
+	if (success && VM_TYPE (page->operations->type) == VM_ANON)
+		anon_readahead_hit (page);
+	vm_unpin_frame (frame);
+	return success;
+}
+
+/* Links FRAME with PAGE, a page of FRAME's owner.
+ * Must be called with FRAME_LOCK held. */
+static void
+frame_link (struct frame *frame, struct page *page) {
+	ASSERT (lock_held_by_current_thread (&frame_lock));
+
+	frame->page = page;
+	page->frame = frame;
+	frame->owner->spt.rss++;
+}
+
+/* Returns FRAME to the user pool and breaks its link with its page.
+ * Must be called with FRAME_LOCK held. */
+static void
+frame_release (struct frame *frame) {
+	ASSERT (lock_held_by_current_thread (&frame_lock));
+	ASSERT (list_empty (&frame->mappers));
+
+	palloc_free_page (frame->kva);
+	frames_used--;
+	frame->ksm_sum = 0;
+	frame->ksm = NULL;
+	frame->shared = NULL;
+	if (frame->page != NULL) {
+		frame->page->frame = NULL;
+		frame->owner->spt.rss--;
+	}
+	frame->page = NULL;
+	frame->owner = NULL;
+	frame->kva = NULL;
+	frame->pinned = false;
+}
+
+/* Shared text frames.  The text cache (see text.c) keeps each one in a
+ * slot of its own, which eviction sets to null under FRAME_LOCK, so the
+ * cache reads and changes its slots only through these functions. */
+
+/* Maps PAGE read-only to the shared frame in *SLOT and adds it to the
+ * frame's mappers, unless it maps the frame already.  Returns false if
+ * *SLOT is null because the frame was evicted, or if memory runs
+ * out. */
+bool
+vm_map_shared_page (struct page *page, struct frame **slot) {
+	bool success;
+
+	lock_acquire (&frame_lock);
+	success = shared_map (page, *slot);
+	lock_release (&frame_lock);
+	return success;
+}
+
+/* Makes FRAME, a frame from vm_get_frame() that holds the contents of a
+ * shared page, the frame in *SLOT and maps PAGE to it, as
+ * vm_map_shared_page() does.  If *SLOT was filled again meanwhile,
+ * FRAME is freed and PAGE maps that frame instead.  Either way FRAME
+ * is consumed. */
+bool
+vm_share_frame (struct frame *frame, struct frame **slot,
+		struct page *page) {
+	bool success;
+
+	lock_acquire (&frame_lock);
+	if (*slot == NULL) {
+		*slot = frame;
+		frame->shared = slot;
+		frame->pinned = false;
+	} else
+		frame_release (frame);
+	success = shared_map (page, *slot);
+	lock_release (&frame_lock);
+	return success;
+}
+
+/* Unmaps PAGE from the shared frame in *SLOT if it maps it. */
+void
+vm_unmap_shared_page (struct page *page, struct frame **slot) {
+	lock_acquire (&frame_lock);
+	if (shared_mapped (page, *slot)) {
+		list_remove (&page->mapper_elem);
+		pml4_clear_page (page->owner->pml4, page->va);
+	}
+	lock_release (&frame_lock);
+}
+
+/* Frees the shared frame in *SLOT, which no page maps any more, unless
+ * it was evicted, and clears *SLOT. */
+void
+vm_free_shared_frame (struct frame **slot) {
+	lock_acquire (&frame_lock);
+	if (*slot != NULL) {
+		frame_release (*slot);
+		*slot = NULL;
+	}
+	lock_release (&frame_lock);
+}
+
+/* Returns FRAME, which was never attached to a page, to the user pool. */
+void
+vm_release_frame (struct frame *frame) {
+	ASSERT (frame != NULL && frame->page == NULL);
+
+	lock_acquire (&frame_lock);
+	frame_release (frame);
+	lock_release (&frame_lock);
+}
+
+/* Unmaps FRAME from its owner and returns it to the user pool.
+ * Called by the page destructors while the owner tears down a page. */
+void
+vm_free_frame (struct frame *frame) {
+	ASSERT (frame != NULL && frame->page != NULL);
+
+	lock_acquire (&frame_lock);
+	pml4_clear_page (frame->owner->pml4, frame->page->va);
+	frame_release (frame);
+	lock_release (&frame_lock);
 }
 
 /* Growing the stack. */
@@ -240,17 +972,630 @@ static bool
 vm_handle_wp (struct page *page UNUSED) {
 }
 
+/* Returns the lazy_load_segment() argument of PAGE if PAGE is still
+ * uninitialized and will be filled from a file, otherwise NULL. */
+static struct lazy_load_file *
+lazy_file_aux (struct page *page) {
+	if (VM_TYPE (page->operations->type) != VM_UNINIT
+			|| page->uninit.init != lazy_load_segment)
+		return NULL;
+	return page->uninit.aux;
+}
+
+/* Returns true if PAGE, a page that lazy_load_segment() will fill, is
+ * part of a read-only ELF segment and so can share the text cache. */
+static bool
+is_text_page (struct page *page) {
+	return !page->writable && VM_TYPE (page->uninit.type) == VM_ANON;
+}
+
+/* Returns true if PAGE is an uninitialized anonymous page whose
+ * initial contents are all zeros: a fresh anonymous page or a page of
+ * an ELF segment that lies wholly past the end of the file data. */
+static bool
+is_zero_page (struct page *page) {
+	struct lazy_load_file *aux;
+
+	if (VM_TYPE (page->operations->type) != VM_UNINIT
+			|| VM_TYPE (page->uninit.type) != VM_ANON)
+		return false;
+	if (page->uninit.init == NULL)
+		return true;
+	aux = lazy_file_aux (page);
+	return aux != NULL && aux->page_read_bytes == 0;
+}
+
+/* Turns PAGE, for which is_zero_page() holds, into an anonymous page
+ * that maps the zero frame read-only.  No frame is allocated until the
+ * process first writes to the page; see vm_unshare_zero_page(). */
+static bool
+vm_map_zero_page (struct page *page) {
+	struct uninit_page *uninit = &page->uninit;
+	bool (*initializer) (struct page *, enum vm_type, void *) =
+		uninit->page_initializer;
+
+	if (!pml4_set_page (thread_current ()->pml4, page->va, zero_kva, false))
+		return false;
+	/* The contents are known, so the lazy initializer is not run. */
+	initializer (page, uninit->type, zero_kva);
+	page->anon.zero = true;
+	zero_map_cnt++;
+	return true;
+}
+
+/* Handles a write to PAGE, which maps the zero frame: gives it a frame
+ * of its own, filled with zeros, and maps that writable instead. */
+static bool
+vm_unshare_zero_page (struct page *page) {
+	uint64_t *pml4 = thread_current ()->pml4;
+	struct frame *frame = vm_get_frame ();
+
+	if (frame == NULL)
+		return false;
+	memset (frame->kva, 0, PGSIZE);
+	pml4_clear_page (pml4, page->va);
+	if (!pml4_set_page (pml4, page->va, frame->kva, page->writable)) {
+		vm_release_frame (frame);
+		return false;
+	}
+	page->anon.zero = false;
+	vm_attach_frame (page, frame);
+	zero_cow_cnt++;
+	return true;
+}
+
+/* Same-page merging. */
+
+static uint64_t
+ksm_page_hash (const struct hash_elem *e, void *aux UNUSED) {
+	return hash_entry (e, struct ksm_page, elem)->sum;
+}
+
+/* Orders merged frames by checksum, then by contents. */
+static bool
+ksm_page_less (const struct hash_elem *a_, const struct hash_elem *b_,
+		void *aux UNUSED) {
+	const struct ksm_page *a = hash_entry (a_, struct ksm_page, elem);
+	const struct ksm_page *b = hash_entry (b_, struct ksm_page, elem);
+
+	if (a->sum != b->sum)
+		return a->sum < b->sum;
+	return memcmp (a->frame->kva, b->frame->kva, PGSIZE) < 0;
+}
+
+static uint64_t
+ksm_candidate_hash (const struct hash_elem *e, void *aux UNUSED) {
+	return hash_entry (e, struct ksm_candidate, elem)->sum;
+}
+
+static bool
+ksm_candidate_less (const struct hash_elem *a, const struct hash_elem *b,
+		void *aux UNUSED) {
+	return hash_entry (a, struct ksm_candidate, elem)->sum
+		< hash_entry (b, struct ksm_candidate, elem)->sum;
+}
+
+static void
+ksm_candidate_free (struct hash_elem *e, void *aux UNUSED) {
+	free (hash_entry (e, struct ksm_candidate, elem));
+}
+
+/* Returns true if FRAME holds a private, mapped anonymous page that
+ * may be merged.  Must be called with FRAME_LOCK held. */
+static bool
+ksm_eligible (struct frame *frame) {
+	struct page *page = frame->page;
+
+	return page != NULL && !frame->pinned
+		&& VM_TYPE (page->operations->type) == VM_ANON
+		&& !page->anon.prefetched
+		&& !pml4_is_huge (frame->owner->pml4, page->va);
+}
+
+/* Makes PAGE share KP, taking a reference to it.
+ * Must be called with FRAME_LOCK held. */
+static void
+ksm_get (struct page *page, struct ksm_page *kp) {
+	page->anon.ksm = kp;
+	kp->ref_cnt++;
+	ksm_shared++;
+}
+
+/* Unmaps PAGE from its merged frame and drops its reference to it.  The
+ * last reference frees the frame, or its swap slot if it was evicted.
+ * Must be called with FRAME_LOCK held, which is released while the
+ * frame is being written out or read back. */
+static void
+ksm_put (struct page *page) {
+	struct ksm_page *kp = page->anon.ksm;
+
+	frame_wait_io (&kp->frame);
+	if (shared_mapped (page, kp->frame)) {
+		list_remove (&page->mapper_elem);
+		pml4_clear_page (page->owner->pml4, page->va);
+	}
+	page->anon.ksm = NULL;
+	ksm_shared--;
+	if (--kp->ref_cnt == 0) {
+		if (kp->stable)
+			hash_delete (&stable_pages, &kp->elem);
+		if (kp->frame != NULL)
+			frame_release (kp->frame);
+		else
+			anon_swap_free_frame (kp->swap_index);
+		free (kp);
+		ksm_frames--;
+	}
+}
+
+/* Unmaps FRAME, so that its owner cannot change it while it is being
+ * compared, and returns whether it was dirty.  ksm_thaw() maps it
+ * back. */
+static bool
+ksm_freeze (struct frame *frame) {
+	uint64_t *pml4 = frame->owner->pml4;
+	bool dirty = pml4_is_dirty (pml4, frame->page->va);
+
+	pml4_clear_page (pml4, frame->page->va);
+	return dirty;
+}
+
+static void
+ksm_thaw (struct frame *frame, bool dirty) {
+	uint64_t *pml4 = frame->owner->pml4;
+	struct page *page = frame->page;
+
+	pml4_set_page (pml4, page->va, frame->kva, page->writable);
+	pml4_set_dirty (pml4, page->va, dirty);
+}
+
+/* Moves the page of FRAME, which ksm_freeze() unmapped, over to KP and
+ * frees FRAME.  Must be called with FRAME_LOCK held. */
+static bool
+ksm_merge (struct frame *frame, struct ksm_page *kp) {
+	struct page *page = frame->page;
+
+	if (!shared_map (page, kp->frame))
+		return false;
+	ksm_get (page, kp);
+	frame_release (frame);
+	ksm_merge_cnt++;
+	return true;
+}
+
+/* Merges FRAME, a stable frame with checksum SUM, with an identical
+ * merged frame or with an identical frame seen earlier in this pass.
+ * In the latter case the contents move to *SPARE, a free frame, and
+ * *SPARE is set to NULL.  Otherwise FRAME is remembered for the rest
+ * of the pass.  Must be called with FRAME_LOCK held. */
+static void
+ksm_scan_frame (struct frame *frame, uint64_t sum, struct frame **spare) {
+	struct ksm_page key, *kp;
+	struct ksm_candidate ckey, *c = NULL;
+	struct hash_elem *e;
+	bool dirty = ksm_freeze (frame);
+
+	key.sum = sum;
+	key.frame = frame;
+	e = hash_find (&stable_pages, &key.elem);
+	if (e != NULL) {
+		/* Not into a frame that is being evicted. */
+		kp = hash_entry (e, struct ksm_page, elem);
+		if (kp->frame->io || !ksm_merge (frame, kp))
+			ksm_thaw (frame, dirty);
+		return;
+	}
+
+	/* The frame seen earlier may have been freed, reused or changed
+	 * since. */
+	ckey.sum = sum;
+	e = hash_delete (&unstable_pages, &ckey.elem);
+	if (e != NULL)
+		c = hash_entry (e, struct ksm_candidate, elem);
+	if (c != NULL && *spare != NULL && c->frame != frame
+			&& c->frame->page == c->page && ksm_eligible (c->frame)) {
+		bool c_dirty = ksm_freeze (c->frame);
+
+		if (!memcmp (c->frame->kva, frame->kva, PGSIZE)
+				&& (kp = malloc (sizeof *kp)) != NULL) {
+			memcpy ((*spare)->kva, frame->kva, PGSIZE);
+			kp->sum = sum;
+			kp->frame = *spare;
+			kp->swap_index = -1;
+			kp->stable = true;
+			kp->ref_cnt = 0;
+			kp->frame->ksm = kp;
+			kp->frame->pinned = false;
+			*spare = NULL;
+			hash_insert (&stable_pages, &kp->elem);
+			ksm_frames++;
+
+			/* Both pages are mapped already, so neither mapping
+			 * needs memory and cannot fail. */
+			ksm_merge (c->frame, kp);
+			ksm_merge (frame, kp);
+			free (c);
+			return;
+		}
+		ksm_thaw (c->frame, c_dirty);
+	}
+	free (c);
+
+	c = malloc (sizeof *c);
+	if (c != NULL) {
+		c->sum = sum;
+		c->frame = frame;
+		c->page = frame->page;
+		hash_insert (&unstable_pages, &c->elem);
+	}
+	ksm_thaw (frame, dirty);
+}
+
+/* Same-page merging thread: every KSM_INTERVAL ticks, checksums the
+ * next VM_KSM_SCAN_RATE frames of the frame table and merges the
+ * stable ones.  Each pass over the whole table starts with an empty
+ * UNSTABLE_PAGES. */
+static void
+ksm_thread (void *aux UNUSED) {
+	for (;;) {
+		struct frame *spare;
+		size_t i;
+
+		timer_sleep (KSM_INTERVAL);
+		spare = vm_get_free_frame ();
+
+		lock_acquire (&frame_lock);
+		for (i = 0; i < vm_ksm_scan_rate; i++) {
+			struct frame *frame = &frame_table[ksm_cursor];
+			uint64_t sum;
+
+			if (ksm_cursor == 0)
+				hash_clear (&unstable_pages, ksm_candidate_free);
+			ksm_cursor = (ksm_cursor + 1) % frame_cnt;
+			if (!ksm_eligible (frame))
+				continue;
+			sum = hash_bytes (frame->kva, PGSIZE);
+			if (sum != frame->ksm_sum)
+				frame->ksm_sum = sum;
+			else
+				ksm_scan_frame (frame, sum, &spare);
+		}
+		lock_release (&frame_lock);
+
+		if (spare != NULL)
+			vm_release_frame (spare);
+	}
+}
+
+/* Initializes same-page merging and starts its thread if -ksm set a
+ * scan rate. */
+static void
+ksm_init (void) {
+	hash_init (&stable_pages, ksm_page_hash, ksm_page_less, NULL);
+	hash_init (&unstable_pages, ksm_candidate_hash, ksm_candidate_less, NULL);
+	if (vm_ksm_scan_rate > 0)
+		thread_create ("ksm", PRI_DEFAULT, ksm_thread, NULL);
+}
+
+/* Makes PAGE, a new anonymous page of the current process, share KP
+ * with the parent page it is copied from.  If KP's frame is evicted,
+ * the page is mapped on its first fault. */
+static bool
+ksm_share_page (struct page *page, struct ksm_page *kp) {
+	struct uninit_page *uninit = &page->uninit;
+	bool success = true;
+
+	uninit->page_initializer (page, uninit->type, NULL);
+	lock_acquire (&frame_lock);
+	ksm_get (page, kp);
+	if (kp->frame != NULL && !kp->frame->io)
+		success = shared_map (page, kp->frame);
+	lock_release (&frame_lock);
+	return success;
+}
+
+/* Returns true if PAGE, a page of the current process, shares a merged
+ * frame.  Only the same-page merging thread makes a page share one,
+ * under FRAME_LOCK, and only the owner makes it stop. */
+static bool
+vm_ksm_page (struct page *page) {
+	return VM_TYPE (page->operations->type) == VM_ANON
+		&& page->anon.ksm != NULL;
+}
+
+/* Returns true if PAGE, a page of the current process, shares a frame
+ * of the text cache. */
+static bool
+vm_text_page (struct page *page) {
+	return VM_TYPE (page->operations->type) == VM_ANON
+		&& page->anon.text != NULL;
+}
+
+/* Maps PAGE, a page of the current process that shares a merged frame,
+ * to that frame, reading the frame back from its swap slot first if it
+ * was evicted.  A fault on the page may also have been waiting for
+ * FRAME_LOCK while the same-page merging thread, which unmaps a frame
+ * while comparing it, merged it; the page is then mapped already. */
+static bool
+vm_ksm_fault_in (struct page *page) {
+	struct ksm_page *kp = page->anon.ksm;
+	struct frame *frame = NULL;
+	bool success = true;
+
+	lock_acquire (&frame_lock);
+	for (;;) {
+		frame_wait_io (&kp->frame);
+		if (kp->frame != NULL || frame != NULL)
+			break;
+		/* Taking a frame may evict, so not under FRAME_LOCK. */
+		lock_release (&frame_lock);
+		frame = vm_get_frame ();
+		if (frame == NULL)
+			return false;
+		lock_acquire (&frame_lock);
+	}
+	if (kp->frame == NULL) {
+		/* Pages faulting on KP meanwhile wait for the read. */
+		struct frame *in = frame;
+
+		frame = NULL;
+		kp->frame = in;
+		in->ksm = kp;
+		in->io = true;
+		lock_release (&frame_lock);
+		anon_swap_read_frame (kp->swap_index, in->kva);
+		lock_acquire (&frame_lock);
+		kp->swap_index = -1;
+		in->io = false;
+		in->pinned = false;
+		cond_broadcast (&io_done, &frame_lock);
+	}
+	success = shared_map (page, kp->frame);
+	lock_release (&frame_lock);
+
+	if (frame != NULL)
+		vm_release_frame (frame);
+	return success;
+}
+
+/* Handles a write to PAGE, which maps a merged frame: gives it a
+ * private copy of the contents.  If the merged frame was evicted since
+ * the fault, the page is unmapped and nothing is done: the access then
+ * faults as not present and maps the frame again first. */
+static bool
+vm_ksm_unshare (struct page *page) {
+	struct frame *frame = vm_get_frame ();
+	bool success = true;
+
+	if (frame == NULL)
+		return false;
+	lock_acquire (&frame_lock);
+	if (!shared_mapped (page, page->anon.ksm->frame)) {
+		lock_release (&frame_lock);
+		vm_release_frame (frame);
+		return true;
+	}
+	/* A merged frame never changes while we hold a reference, and a
+	 * mapped one is not evicted while we hold FRAME_LOCK. */
+	memcpy (frame->kva, page->anon.ksm->frame->kva, PGSIZE);
+	ksm_put (page);
+	if (pml4_set_page (page->owner->pml4, page->va, frame->kva,
+				page->writable)) {
+		frame_link (frame, page);
+		vm_unpin_frame (frame);
+		ksm_unshare_cnt++;
+	} else {
+		frame_release (frame);
+		success = false;
+	}
+	lock_release (&frame_lock);
+	return success;
+}
+
+/* Unmaps PAGE, an anonymous page of the current process, and gives up
+ * its frame: returns a private frame to the user pool or drops the
+ * reference to a merged frame.  Same-page merging may switch the page
+ * from one to the other until FRAME_LOCK is held, and eviction may be
+ * writing the private frame out, which we wait for. */
+void
+vm_free_anon_frame (struct page *page) {
+	lock_acquire (&frame_lock);
+	frame_wait_io (&page->frame);
+	if (page->anon.ksm != NULL)
+		ksm_put (page);
+	else if (page->frame != NULL) {
+		pml4_clear_page (page->frame->owner->pml4, page->va);
+		frame_release (page->frame);
+	}
+	lock_release (&frame_lock);
+}
+
+/* Called after PAGE, a lazily loaded page of FILE, was faulted in:
+ * loads and maps the pages that follow it in SPT, as long as they are
+ * lazily loaded from the same file, up to the fault-around window.
+ * Uses free frames only, so it never causes eviction.  After a read
+ * fault (!WRITE), pages past the end of the file data map the zero
+ * frame instead of taking a frame each. */
+static void
+vm_fault_around (struct supplemental_page_table *spt, struct page *page,
+		struct file *file, bool write) {
+	uint64_t *pml4 = thread_current ()->pml4;
+	size_t i;
+
+	if (page->advice == MADV_SEQUENTIAL)
+		spt->fa_window = FAULT_AROUND_MAX;
+	else if (page->va == spt->fa_next) {
+		if (spt->fa_window < FAULT_AROUND_MAX)
+			spt->fa_window *= 2;
+	} else if (spt->fa_window > FAULT_AROUND_MIN)
+		spt->fa_window /= 2;
+
+	for (i = 1; i <= spt->fa_window; i++) {
+		void *va = page->va + i * PGSIZE;
+		struct page *next = spt_find_page (spt, va);
+		struct lazy_load_file *aux;
+		struct frame *frame;
+
+		if (next == NULL)
+			break;
+		aux = lazy_file_aux (next);
+		if (aux == NULL || aux->file != file || pml4_get_page (pml4, va) != NULL)
+			break;
+		if (is_text_page (next)) {
+			if (!text_claim_page (next, aux))
+				break;
+			fault_around_cnt++;
+			continue;
+		}
+		if (!write && is_zero_page (next)) {
+			if (!vm_map_zero_page (next))
+				break;
+			fault_around_cnt++;
+			continue;
+		}
+		frame = vm_get_free_frame ();
+		if (frame == NULL)
+			break;
+
+		lock_acquire (&frame_lock);
+		frame_link (frame, next);
+		lock_release (&frame_lock);
+
+		/* Fill the frame before mapping it: unlike a real fault, the
+		 * process may touch VA as soon as it is mapped. */
+		if (!swap_in (next, frame->kva)
+				|| !pml4_set_page (pml4, va, frame->kva, next->writable)) {
+			lock_acquire (&frame_lock);
+			frame_release (frame);
+			lock_release (&frame_lock);
+			break;
+		}
+		frame->pinned = false;
+		fault_around_cnt++;
+	}
+	spt->fa_next = page->va + i * PGSIZE;
+}
+
+/* Promotes the 2 MiB region around VA in the current process to a
+ * huge page if every page in it is a resident, private anonymous page
+ * with the same writability.  The contents move to HPG_PAGE_CNT
+ * contiguous frames that a single PDE maps.  If the user pool has no
+ * aligned run of free frames, the region stays mapped by 4 KiB pages. */
+static void
+vm_try_promote (void *va) {
+	struct thread *t = thread_current ();
+	void *base = hpg_round_down (va);
+	struct page **pages;
+	uint8_t *hkva;
+	size_t i;
+
+	if (!vm_huge_pages || !pml4_huge_candidate (t->pml4, base))
+		return;
+
+	/* HPG_PAGE_CNT pointers fill exactly one page. */
+	pages = palloc_get_page (0);
+	if (pages == NULL)
+		return;
+	for (i = 0; i < HPG_PAGE_CNT; i++) {
+		struct page *page = spt_find_page (&t->spt, base + i * PGSIZE);
+		if (page == NULL || VM_TYPE (page->operations->type) != VM_ANON
+				|| page->frame == NULL || page->anon.text != NULL
+				|| page->anon.prefetched)
+			goto done;
+		pages[i] = page;
+	}
+
+	hkva = palloc_get_huge_page (PAL_USER);
+	if (hkva == NULL) {
+		huge_fail_cnt++;
+		goto done;
+	}
+
+	/* Copy the contents over, then switch the mapping and the frame
+	 * table over before the old frames can be reused. */
+	lock_acquire (&frame_lock);
+	for (i = 0; i < HPG_PAGE_CNT; i++)
+		if (pages[i]->frame == NULL || pages[i]->frame->pinned) {
+			/* Evicted or busy since we looked. */
+			lock_release (&frame_lock);
+			palloc_free_multiple (hkva, HPG_PAGE_CNT);
+			goto done;
+		}
+	for (i = 0; i < HPG_PAGE_CNT; i++) {
+		struct frame *old = pages[i]->frame;
+		struct frame *new = &frame_table[palloc_user_page_idx (hkva + i * PGSIZE)];
+
+		memcpy (hkva + i * PGSIZE, old->kva, PGSIZE);
+		new->kva = hkva + i * PGSIZE;
+		new->page = pages[i];
+		new->owner = t;
+		new->pinned = false;
+		pages[i]->frame = new;
+		old->page = NULL;
+		frame_release (old);
+	}
+	frames_used += HPG_PAGE_CNT;
+	pml4_set_huge_page (t->pml4, base, hkva, pages[0]->writable);
+	huge_cnt++;
+	lock_release (&frame_lock);
+
+done:
+	palloc_free_page (pages);
+}
+
+static bool vm_handle_fault (struct intr_frame *f, void *addr, bool user,
+		bool write, bool not_present);
+
 /* Return true on success */
 bool
-vm_try_handle_fault (struct intr_frame *f UNUSED, void *addr UNUSED,
+vm_try_handle_fault (struct intr_frame *f, void *addr, bool user,
+		bool write, bool not_present) {
+	int64_t start = timer_ticks ();
+	bool success = vm_handle_fault (f, addr, user, write, not_present);
+	int64_t elapsed = timer_elapsed (start);
+	int bucket = 0;
+
+	while (bucket < FAULT_LATENCY_BUCKETS - 1 && elapsed >= (1 << bucket))
+		bucket++;
+	fault_latency[bucket]++;
+	return success;
+}
+
+/* Handles a page fault at ADDR; see vm_try_handle_fault(). */
+static bool
+vm_handle_fault (struct intr_frame *f UNUSED, void *addr UNUSED,
 		bool user UNUSED, bool write UNUSED, bool not_present UNUSED) {
 	struct supplemental_page_table *spt UNUSED = &thread_current ()->spt;
 	struct page *page = NULL;
+	struct lazy_load_file *lazy;
 	/* TODO: Validate the fault */
 	/* TODO: Your code goes here */
-	if (is_kernel_vaddr(addr) || !addr || !not_present)	{
+	if (is_kernel_vaddr(addr) || !addr)	{
 		return false;
 	}
+	fault_cnt++;
+	pff_fault (spt);
+
+	/* The only protection faults we handle are the first write to a
+	 * page that maps the zero frame or a merged frame, whether by the
+	 * process or by the kernel on its behalf, e.g. in read(): CR0.WP
+	 * makes kernel writes honour read-only mappings too. */
+	if (!not_present) {
+		page = spt_find_page (spt, addr);
+		if (!write || page == NULL || !page->writable
+				|| VM_TYPE (page->operations->type) != VM_ANON)
+			return false;
+		if (page->anon.zero) {
+			if (!vm_unshare_zero_page (page))
+				return false;
+		} else if (page->anon.ksm != NULL) {
+			if (!vm_ksm_unshare (page))
+				return false;
+		} else
+			return false;
+		vm_try_promote (page->va);
+		return true;
+	}
 
 	page = spt_find_page(spt, addr);
 	if ( page == NULL && USER_STACK >= addr && addr >= USER_STACK-(1 << 20)){
@@ -264,7 +1609,40 @@ vm_try_handle_fault (struct intr_frame *f UNUSED, void *addr UNUSED,
 	}
 	if (page == NULL) return false;
 
-	return vm_do_claim_page(page);
+	/* Merged, perhaps while the fault was on its way here. */
+	if (vm_ksm_page (page))
+		return vm_ksm_fault_in (page);
+	/* Shared text whose frame was evicted. */
+	if (vm_text_page (page))
+		return text_fault_in (page);
+
+	/* Resident but unmapped, e.g. brought in by swap readahead. */
+	if (page->frame != NULL) {
+		if (!vm_map_resident_page (page))
+			return false;
+		vm_try_promote (page->va);
+		return true;
+	}
+
+	lazy = lazy_file_aux (page);
+	if (!write && is_zero_page (page)) {
+		if (!vm_map_zero_page (page))
+			return false;
+	} else if (lazy != NULL && is_text_page (page)) {
+		if (!text_claim_page (page, lazy))
+			return false;
+	} else if (!vm_do_claim_page (page))
+		return false;
+	vm_try_promote (page->va);
+	if (page->advice == MADV_SEQUENTIAL)
+		vm_drop_behind (spt, page->va);
+	if (lazy != NULL && page->advice != MADV_RANDOM) {
+		vm_fault_around (spt, page, lazy->file, write);
+		/* Fault-around may have completed the next region. */
+		if (hpg_round_down (spt->fa_next - 1) != hpg_round_down (page->va))
+			vm_try_promote (spt->fa_next - 1);
+	}
+	return true;
 }
 
 /* Free the page.
@@ -309,13 +1687,19 @@ vm_do_claim_page (struct page *page) {
 	}
 
 	/* Set links */
-	frame->page = page;
-	page->frame = frame;
+	lock_acquire (&frame_lock);
+	frame_link (frame, page);
+	lock_release (&frame_lock);
 
 	/* TODO: Insert page table entry to map page's VA to frame's PA. */
 	if (pml4_get_page(thread_current()->pml4, page->va) == NULL && pml4_set_page(thread_current()->pml4, page->va, frame->kva, page->writable)){
-		return swap_in (page, frame->kva);
+		bool success = swap_in (page, frame->kva);
+		frame->pinned = false;
+		return success;
 	}
+	lock_acquire (&frame_lock);
+	frame_release (frame);
+	lock_release (&frame_lock);
 	return false;
 }
 
@@ -325,6 +1709,65 @@ vm_do_claim_page (struct page *page) {
 void
 supplemental_page_table_init (struct supplemental_page_table *spt UNUSED) {
 	hash_init(&spt->table, hash_hash, hash_less, NULL);
+	spt->fa_next = NULL;
+	spt->fa_window = FAULT_AROUND_INIT;
+	spt->pff_start = timer_ticks ();
+	spt->pff_faults = 0;
+	spt->rss = 0;
+	spt->ws = 0;
+	spt->quota = frame_cnt;
+	spt->heap_start = NULL;
+	spt->heap_brk = NULL;
+}
+
+/* Pins and returns the frame of PAGE, an anonymous page of the parent
+ * of the current process, which is being forked, so that the child can
+ * copy it.  A page that is swapped out is read back into a frame of the
+ * parent first and left unmapped, as swap readahead leaves pages; the
+ * parent maps it on its next fault.  Returns NULL if memory runs out. */
+static struct frame *
+vm_pin_parent_page (struct page *page) {
+	struct frame *frame = vm_pin_page (page);
+
+	if (frame != NULL)
+		return frame;
+	frame = vm_get_frame ();
+	if (frame == NULL)
+		return NULL;
+	lock_acquire (&frame_lock);
+	frame->owner = page->owner;
+	frame_link (frame, page);
+	lock_release (&frame_lock);
+	if (!swap_in (page, frame->kva)) {
+		lock_acquire (&frame_lock);
+		frame_release (frame);
+		lock_release (&frame_lock);
+		return NULL;
+	}
+	return frame;
+}
+
+/* Turns PAGE, a new anonymous page of the current process, into a
+ * private copy of the parent page held in PAR_FRAME, which the caller
+ * has pinned.  The copy is made in a pinned frame before the frame is
+ * attached, so it cannot be evicted half written. */
+static bool
+vm_copy_anon_page (struct page *page, struct frame *par_frame) {
+	struct uninit_page *uninit = &page->uninit;
+	struct frame *frame = vm_get_frame ();
+
+	if (frame == NULL)
+		return false;
+	memcpy (frame->kva, par_frame->kva, PGSIZE);
+	if (!pml4_set_page (thread_current ()->pml4, page->va, frame->kva,
+				page->writable)) {
+		vm_release_frame (frame);
+		return false;
+	}
+	/* The contents are known, so the lazy initializer is not run. */
+	uninit->page_initializer (page, uninit->type, frame->kva);
+	vm_attach_frame (page, frame);
+	return true;
 }
 
 /* Copy supplemental page table from src to dst */
@@ -337,14 +1780,74 @@ supplemental_page_table_copy (struct supplemental_page_table *dst ,
 	while (hash_next (&i))
 	{
 		struct page *par_page = hash_entry (hash_cur (&i), struct page, hash_elem);
-		vm_alloc_page_with_initializer(page_get_type(par_page), par_page->va, par_page->writable, par_page->anon.init, par_page->anon.aux);
-		
-		if (par_page->operations->type == VM_ANON){
-			vm_claim_page(par_page->va);
-			memcpy(spt_find_page(dst, par_page->va)->frame->kva, par_page->frame->kva, PGSIZE);
+
+		/* Shared text pages stay shared with the child. */
+		if (par_page->operations->type == VM_ANON && par_page->anon.text != NULL) {
+			if (!vm_alloc_page (VM_ANON, par_page->va, false)
+					|| !text_share_page (spt_find_page (dst, par_page->va),
+						par_page->anon.text))
+				return false;
+			continue;
+		}
+		/* So do pages that map the zero frame. */
+		if (par_page->operations->type == VM_ANON && par_page->anon.zero) {
+			struct page *page;
+
+			if (!vm_alloc_page (VM_ANON, par_page->va, par_page->writable))
+				return false;
+			page = spt_find_page (dst, par_page->va);
+			if (!vm_map_zero_page (page))
+				return false;
+			continue;
+		}
+		/* So do pages that map a merged frame. */
+		if (par_page->operations->type == VM_ANON && par_page->anon.ksm != NULL) {
+			if (!vm_alloc_page (VM_ANON, par_page->va, par_page->writable)
+					|| !ksm_share_page (spt_find_page (dst, par_page->va),
+						par_page->anon.ksm))
+				return false;
+			spt_find_page (dst, par_page->va)->anon.file_data =
+				par_page->anon.file_data;
+			continue;
 		}
+		/* File mappings are mapped again on files of the child's own. */
+		if (page_get_type (par_page) == VM_FILE) {
+			if (par_page->seq_num > 0 && !do_mmap_copy (par_page))
+				return false;
+			continue;
+		}
+		if (par_page->operations->type == VM_ANON) {
+			struct page *page;
+			struct frame *par_frame;
+			bool success;
+
+			if (!vm_alloc_page (VM_ANON, par_page->va, par_page->writable))
+				return false;
+			page = spt_find_page (dst, par_page->va);
+			par_frame = vm_pin_parent_page (par_page);
+			if (par_frame == NULL)
+				return false;
+			success = vm_copy_anon_page (page, par_frame);
+			vm_unpin_frame (par_frame);
+			if (!success)
+				return false;
+			page->anon.file_data = par_page->anon.file_data;
+			continue;
+		}
+		vm_alloc_page_with_initializer(page_get_type(par_page), par_page->va, par_page->writable, par_page->anon.init, par_page->anon.aux);
 
 	};
+
+	/* The child inherits the heap and its anonymous mappings. */
+	dst->heap_start = src->heap_start;
+	dst->heap_brk = src->heap_brk;
+	hash_first (&i, &src->table);
+	while (hash_next (&i)) {
+		struct page *par_page = hash_entry (hash_cur (&i), struct page, hash_elem);
+
+		if (page_get_type (par_page) == VM_ANON && par_page->seq_num > 0)
+			spt_find_page (dst, par_page->va)->seq_num = par_page->seq_num;
+	}
 	return true;
 
 }
@@ -356,8 +1859,14 @@ supplemental_page_table_kill (struct supplemental_page_table *spt) {
 	//  * TODO: writeback all the modified contents to the storage. */
 	
 	// hash_destroy()로 해시 테이블의 버킷 리스트와, vm_entry(page-hash_elem) 제거
+	file_backed_teardown (spt);
 	hash_destroy(&spt->table, hash_destroy_func);	
 
+	lock_acquire (&frame_lock);
+	pff_ws_total -= spt->ws;
+	spt->ws = 0;
+	lock_release (&frame_lock);
+
 	// 추가 : spt_remove_page()도 있다..! -> 깃북을 보면 spt는 함수 호출자가 알아서 정리한다고 한다.
 
 }
@@ -373,8 +1882,382 @@ hash_destroy_func(struct hash_elem *e, void* aux){
 	pagedir_clear_page() 사용) */
 	/* vm_entry 객체 할당 해제 */
 	struct page* kill_page = hash_entry(e, struct page, hash_elem);
+	vm_page_unlocked (kill_page);
 	vm_dealloc_page(kill_page);
 
 	// 페이지 로드 여부 확인 및 page 할당 해제 + page mapping 해제 -> 이거 지금 해야 하나?
 }
 
+/* Memory advice and locking. */
+
+/* Returns the number of pages that cover the LENGTH bytes at ADDR in
+ * *CNT, or false if ADDR is not page aligned or some of the pages do
+ * not exist in the current process. */
+static bool
+vm_range (const void *addr, size_t length, size_t *cnt) {
+	struct supplemental_page_table *spt = &thread_current ()->spt;
+	size_t i, n = DIV_ROUND_UP (length, PGSIZE);
+
+	if (addr == NULL || pg_ofs (addr) != 0
+			|| (uint64_t) addr + length < (uint64_t) addr
+			|| !is_user_vaddr (addr + length))
+		return false;
+	for (i = 0; i < n; i++)
+		if (spt_find_page (spt, (void *) addr + i * PGSIZE) == NULL)
+			return false;
+	*cnt = n;
+	return true;
+}
+
+/* Makes PAGE, a page of the current process, resident and mapped, as
+ * a fault on it would. */
+static bool
+vm_fault_in (struct page *page) {
+	struct lazy_load_file *lazy;
+
+	if (pml4_get_page (thread_current ()->pml4, page->va) != NULL)
+		return true;
+	if (vm_ksm_page (page))
+		return vm_ksm_fault_in (page);
+	if (vm_text_page (page))
+		return text_fault_in (page);
+	if (page->frame != NULL)
+		return vm_map_resident_page (page);
+	lazy = lazy_file_aux (page);
+	if (lazy != NULL && is_text_page (page))
+		return text_claim_page (page, lazy);
+	return vm_do_claim_page (page);
+}
+
+/* Brings PAGE, a page of the current process, in for MADV_WILLNEED and
+ * maps it, using free frames only, like fault-around.  Pages whose
+ * contents are known to be zero and pages that share an evicted merged
+ * or text frame are left for their first fault.
+ * Returns false if the user pool has no free frame. */
+static bool
+vm_prefetch_page (struct page *page) {
+	uint64_t *pml4 = thread_current ()->pml4;
+	struct lazy_load_file *lazy;
+	struct frame *frame;
+
+	if (pml4_get_page (pml4, page->va) != NULL || is_zero_page (page)
+			|| vm_ksm_page (page) || vm_text_page (page))
+		return true;
+	if (page->frame != NULL)
+		return vm_map_resident_page (page);
+	lazy = lazy_file_aux (page);
+	if (lazy != NULL && is_text_page (page))
+		return text_claim_page (page, lazy);
+
+	frame = vm_get_free_frame ();
+	if (frame == NULL)
+		return false;
+	lock_acquire (&frame_lock);
+	frame_link (frame, page);
+	lock_release (&frame_lock);
+	if (!swap_in (page, frame->kva)
+			|| !pml4_set_page (pml4, page->va, frame->kva, page->writable)) {
+		lock_acquire (&frame_lock);
+		frame_release (frame);
+		lock_release (&frame_lock);
+		return true;
+	}
+	vm_unpin_frame (frame);
+	prefetch_cnt++;
+	return true;
+}
+
+/* Drops the contents of PAGE, a page of SPT, for MADV_DONTNEED.  A page
+ * of a file mapping is written back if dirty and read again on its next
+ * access; a writable anonymous page starts over as a zero-filled page.
+ * Locked and read-only pages are left alone, and so are anonymous pages
+ * that hold data from the executable, such as .data: zero-filling them
+ * would lose it, and the executable may no longer be open. */
+static void
+vm_drop_page (struct supplemental_page_table *spt, struct page *page) {
+	enum vm_type type = VM_TYPE (page->operations->type);
+
+	if (page->locked)
+		return;
+	if (type == VM_FILE) {
+		struct frame *frame = vm_pin_page (page);
+
+		if (frame != NULL) {
+			swap_out (page);
+			vm_free_frame (frame);
+			dontneed_cnt++;
+		}
+	} else if (type == VM_ANON && page->writable && !page->anon.file_data) {
+		void *va = page->va;
+		int advice = page->advice;
+		int seq_num = page->seq_num;
+		struct page *fresh;
+
+		/* The first page of an anonymous mapping keeps the mapping's
+		 * length, which do_munmap() needs. */
+		spt_remove_page (spt, page);
+		if (vm_alloc_page (VM_ANON, va, true)) {
+			fresh = spt_find_page (spt, va);
+			fresh->advice = advice;
+			fresh->seq_num = seq_num;
+		}
+		dontneed_cnt++;
+	}
+}
+
+/* Called on a fault at VA in a region advised MADV_SEQUENTIAL: marks
+ * the resident pages of the region that lie well behind VA as not
+ * accessed, so that the clock takes them before any other page. */
+static void
+vm_drop_behind (struct supplemental_page_table *spt, void *va) {
+	uint64_t *pml4 = thread_current ()->pml4;
+	size_t i;
+
+	for (i = 1; i <= FAULT_AROUND_MAX; i++) {
+		void *behind = va - (FAULT_AROUND_MAX + i) * PGSIZE;
+		struct page *page;
+
+		if (behind > va)
+			break;
+		page = spt_find_page (spt, behind);
+		if (page != NULL && page->advice == MADV_SEQUENTIAL
+				&& page->frame != NULL)
+			pml4_set_accessed (pml4, behind, false);
+	}
+}
+
+/* Gives ADVICE, one of MADV_*, about the LENGTH bytes at ADDR.
+ * MADV_NORMAL, MADV_RANDOM and MADV_SEQUENTIAL are recorded in the
+ * pages and steer fault-around, swap readahead and drop-behind.
+ * MADV_WILLNEED and MADV_DONTNEED act on the pages at once.  Returns 0
+ * on success, -1 if the advice or range is invalid. */
+int
+vm_madvise (void *addr, size_t length, int advice) {
+	struct supplemental_page_table *spt = &thread_current ()->spt;
+	size_t cnt, i;
+
+	if (advice < MADV_NORMAL || advice > MADV_DONTNEED
+			|| !vm_range (addr, length, &cnt))
+		return -1;
+
+	for (i = 0; i < cnt; i++) {
+		struct page *page = spt_find_page (spt, addr + i * PGSIZE);
+
+		if (advice == MADV_WILLNEED) {
+			/* Prefetching never evicts: stop once memory is full. */
+			if (!vm_prefetch_page (page))
+				break;
+		} else if (advice == MADV_DONTNEED)
+			vm_drop_page (spt, page);
+		else
+			page->advice = advice;
+	}
+	return 0;
+}
+
+/* Locks PAGE, a page of the current process, in memory.  A writable
+ * page that maps the zero frame is given a frame of its own first, so
+ * that a later write cannot need memory.  So is a page that shares a
+ * merged or text frame, which may be evicted, so that locking it pins
+ * no frame that other processes map. */
+static bool
+vm_lock_page (struct page *page) {
+	for (;;) {
+		struct frame *frame;
+
+		if (VM_TYPE (page->operations->type) == VM_ANON) {
+			struct anon_page *anon = &page->anon;
+
+			if (page->writable && anon->zero && !vm_unshare_zero_page (page))
+				return false;
+			if (anon->zero)
+				break;          /* The zero frame is never evicted. */
+			if (anon->text != NULL) {
+				if (!text_unshare_page (page))
+					return false;
+				continue;
+			}
+		}
+		if (!vm_fault_in (page))
+			return false;
+		/* A shared page faulted in, or merged, meanwhile: copy it. */
+		if (vm_ksm_page (page)) {
+			if (!vm_ksm_unshare (page))
+				return false;
+			continue;
+		}
+		if (vm_text_page (page))
+			continue;
+
+		frame = vm_pin_page (page);
+		if (frame != NULL && pml4_get_page (thread_current ()->pml4,
+					page->va) != NULL)
+			break;
+		/* Evicted before it could be pinned: fault it in again. */
+		if (frame != NULL)
+			vm_unpin_frame (frame);
+	}
+	page->locked = true;
+	return true;
+}
+
+/* Called when PAGE goes away, to forget that it was locked. */
+static void
+vm_page_unlocked (struct page *page) {
+	if (page->locked) {
+		lock_acquire (&frame_lock);
+		locked_cnt--;
+		lock_release (&frame_lock);
+		page->locked = false;
+	}
+}
+
+/* Locks the pages that cover the LENGTH bytes at ADDR in memory if
+ * LOCK is true, so that vm_get_victim() never picks them, or unlocks
+ * them if LOCK is false.  Returns 0 on success, -1 if the range is
+ * invalid or if locking it would pin more than half of the user
+ * pool. */
+int
+vm_mlock (const void *addr, size_t length, bool lock) {
+	struct supplemental_page_table *spt = &thread_current ()->spt;
+	size_t cnt, i;
+
+	if (!vm_range (addr, length, &cnt))
+		return -1;
+
+	for (i = 0; i < cnt; i++) {
+		struct page *page = spt_find_page (spt, (void *) addr + i * PGSIZE);
+
+		if (page->locked == lock)
+			continue;
+		if (lock) {
+			bool ok;
+
+			lock_acquire (&frame_lock);
+			ok = (size_t) locked_cnt < frame_cnt / 2;
+			if (ok)
+				locked_cnt++;
+			lock_release (&frame_lock);
+			if (!ok)
+				return -1;
+			if (!vm_lock_page (page)) {
+				lock_acquire (&frame_lock);
+				locked_cnt--;
+				lock_release (&frame_lock);
+				return -1;
+			}
+		} else {
+			vm_page_unlocked (page);
+			lock_acquire (&frame_lock);
+			if (page->frame != NULL)
+				page->frame->pinned = false;
+			lock_release (&frame_lock);
+		}
+	}
+	return 0;
+}
+
+/* Anonymous mappings and the heap. */
+
+/* Lowest address the stack may grow down to (see vm_handle_fault()). */
+#define STACK_LIMIT ((void *) (USER_STACK - (1 << 20)))
+
+/* Returns true if none of the CNT pages from VA exists in SPT and all of
+ * them lie below the stack. */
+static bool
+vm_range_free (struct supplemental_page_table *spt, void *va, size_t cnt) {
+	size_t i;
+
+	if ((uint64_t) va + cnt * PGSIZE < (uint64_t) va
+			|| va + cnt * PGSIZE > STACK_LIMIT)
+		return false;
+	for (i = 0; i < cnt; i++)
+		if (spt_find_page (spt, va + i * PGSIZE) != NULL)
+			return false;
+	return true;
+}
+
+/* Removes the CNT pages from VA from SPT, skipping any that do not
+ * exist. */
+static void
+vm_remove_range (struct supplemental_page_table *spt, void *va, size_t cnt) {
+	size_t i;
+
+	for (i = 0; i < cnt; i++) {
+		struct page *page = spt_find_page (spt, va + i * PGSIZE);
+
+		if (page != NULL)
+			spt_remove_page (spt, page);
+	}
+}
+
+/* Maps LENGTH bytes of zero-filled anonymous memory at ADDR, which must
+ * be page aligned, in the current process.  The pages are lazy: each
+ * maps the shared zero frame on its first read and gets a frame of its
+ * own on its first write.  The first page records the mapping's length
+ * in pages, as for file mappings, so that do_munmap() can remove it.
+ * Returns ADDR, or NULL if the range is invalid or overlaps an existing
+ * page. */
+void *
+vm_mmap_anon (void *addr, size_t length, bool writable) {
+	struct supplemental_page_table *spt = &thread_current ()->spt;
+	size_t cnt = DIV_ROUND_UP (length, PGSIZE);
+	size_t i;
+
+	if (addr == NULL || pg_ofs (addr) != 0 || length == 0
+			|| (long long) length < 0 || !vm_range_free (spt, addr, cnt))
+		return NULL;
+	for (i = 0; i < cnt; i++)
+		if (!vm_alloc_page (VM_ANON, addr + i * PGSIZE, writable)) {
+			vm_remove_range (spt, addr, i);
+			return NULL;
+		}
+	spt_find_page (spt, addr)->seq_num = cnt;
+	return addr;
+}
+
+/* Sets the bottom of the current process's heap, which starts out
+ * empty, to HEAP_START, the first page past its loaded segments. */
+void
+vm_heap_init (void *heap_start) {
+	struct supplemental_page_table *spt = &thread_current ()->spt;
+
+	ASSERT (pg_ofs (heap_start) == 0);
+	spt->heap_start = spt->heap_brk = heap_start;
+}
+
+/* Moves the current process's break by INCREMENT bytes and returns the
+ * old break, or (void *) -1 if the heap cannot grow or shrink that far.
+ * Pages the break moves past are lazy anonymous pages, zero-filled on
+ * first use; pages it falls back from are freed. */
+void *
+vm_sbrk (intptr_t increment) {
+	struct supplemental_page_table *spt = &thread_current ()->spt;
+	void *old_brk = spt->heap_brk;
+	void *new_brk = old_brk + increment;
+	void *old_end = pg_round_up (old_brk);
+	void *new_end = pg_round_up (new_brk);
+	size_t i;
+
+	if (spt->heap_start == NULL
+			|| (increment > 0 && new_brk < old_brk)
+			|| (increment < 0 && new_brk > old_brk)
+			|| new_brk < spt->heap_start)
+		return (void *) -1;
+
+	if (new_end > old_end) {
+		size_t cnt = (new_end - old_end) / PGSIZE;
+
+		if (!vm_range_free (spt, old_end, cnt))
+			return (void *) -1;
+		for (i = 0; i < cnt; i++)
+			if (!vm_alloc_page (VM_ANON, old_end + i * PGSIZE, true)) {
+				vm_remove_range (spt, old_end, i);
+				return (void *) -1;
+			}
+	} else if (new_end < old_end)
+		vm_remove_range (spt, new_end, (old_end - new_end) / PGSIZE);
+
+	spt->heap_brk = new_brk;
+	return old_brk;
+}
@@ -0,0 +1,284 @@
+/* zswap.c: Compressed in-memory tier in front of the swap disk.
+ *
+ * Evicted anonymous pages are first compressed into a pool of kernel
+ * memory.  A page whose bytes are all the same is stored as just that
+ * byte.  The pool is kept in least recently stored order; when a new
+ * page does not fit, the coldest entries are decompressed and written
+ * to the swap disk to make room.  Pages that compress poorly go to the
+ * swap disk directly.
+ *
+ * The compressor is a small LZSS: a control byte announces eight
+ * items, each either a literal byte or a back reference of a 12-bit
+ * offset and a 4-bit length, with one more byte of length for long
+ * matches.  Matches are found through a hash table of the most recent
+ * position of each 3-byte prefix.
+ *
+ * Every function here must be called with the swap lock held (see
+ * anon.c), which also protects the compressor's static buffers. */
+
+#include "vm/zswap.h"
+#include "vm/vm.h"
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/vaddr.h"
+#include <list.h>
+#include <stdio.h>
+#include <string.h>
+
+/* A compressed page in the pool. */
+struct zswap_entry {
+	struct list_elem elem;      /* Element in POOL, coldest first. */
+	struct page *page;          /* Page whose contents these are. */
+	size_t len;                 /* Compressed bytes, 0 if same-filled. */
+	uint8_t fill;               /* Every byte, if same-filled. */
+	uint8_t data[];             /* LEN bytes of compressed contents. */
+};
+
+/* Compressed pages kept only if they shrink to at most this size. */
+#define ZSWAP_MAX_LEN (PGSIZE * 3 / 4)
+
+/* Compressor parameters. */
+#define LZ_HASH_BITS 12
+#define LZ_MIN_MATCH 3
+#define LZ_MAX_SHORT (LZ_MIN_MATCH + 15)        /* Longest 4-bit length. */
+#define LZ_MAX_MATCH (LZ_MAX_SHORT + 255)
+#define LZ_MAX_OFFSET 4095
+
+static struct list pool;
+static size_t pool_bytes;               /* Bytes held by POOL's entries. */
+static size_t pool_max;                 /* Most bytes POOL may hold. */
+
+/* Static work areas, too big for a kernel stack. */
+static int16_t lz_table[1 << LZ_HASH_BITS];
+static uint8_t *lz_buf;                 /* Compressor output. */
+static uint8_t *writeback_buf;          /* Page being written back. */
+
+/* Statistics. */
+static long long store_cnt;             /* Pages stored. */
+static long long same_cnt;              /* ...of which were same-filled. */
+static long long reject_cnt;            /* Pages that compressed poorly. */
+static long long writeback_cnt;         /* Entries moved to the swap disk. */
+static long long orig_bytes;            /* Bytes of pages stored. */
+static long long comp_bytes;            /* ...after compression. */
+
+/* Initializes the compressed pool, which may grow to a fifth of the
+ * user pool. */
+void
+zswap_init (void) {
+	list_init (&pool);
+	pool_bytes = 0;
+	pool_max = palloc_user_page_cnt () / 5 * PGSIZE;
+	lz_buf = palloc_get_page (PAL_ASSERT);
+	writeback_buf = palloc_get_page (PAL_ASSERT);
+}
+
+/* Prints compressed pool statistics. */
+void
+zswap_print_stats (void) {
+	printf ("Zswap: %lld pages stored (%lld same-filled), %lld rejected, "
+			"%lld written back\n",
+			store_cnt, same_cnt, reject_cnt, writeback_cnt);
+	printf ("Zswap: compressed to %lld%% of original size, "
+			"%zu of %zu pool bytes in use\n",
+			orig_bytes ? comp_bytes * 100 / orig_bytes : 0,
+			pool_bytes, pool_max);
+}
+
+static unsigned
+lz_hash (const uint8_t *p) {
+	uint32_t v = p[0] | (p[1] << 8) | (p[2] << 16);
+	return (v * 2654435761u) >> (32 - LZ_HASH_BITS);
+}
+
+/* Compresses the page at SRC into DST, which holds MAX bytes.  Returns
+ * the compressed length, or 0 if it would not fit. */
+static size_t
+lz_compress (const uint8_t *src, uint8_t *dst, size_t max) {
+	size_t ip = 0, op = 0, ctrl = 0;
+	int bit = 8;
+
+	memset (lz_table, 0xff, sizeof lz_table);
+	while (ip < PGSIZE) {
+		size_t len = 0, off = 0;
+
+		if (bit == 8) {
+			if (op >= max)
+				return 0;
+			ctrl = op++;
+			dst[ctrl] = 0;
+			bit = 0;
+		}
+
+		if (ip + LZ_MIN_MATCH <= PGSIZE) {
+			unsigned h = lz_hash (src + ip);
+			int cand = lz_table[h];
+
+			lz_table[h] = ip;
+			if (cand >= 0 && ip - cand <= LZ_MAX_OFFSET
+					&& !memcmp (src + cand, src + ip, LZ_MIN_MATCH)) {
+				off = ip - cand;
+				len = LZ_MIN_MATCH;
+				while (len < LZ_MAX_MATCH && ip + len < PGSIZE
+						&& src[cand + len] == src[ip + len])
+					len++;
+			}
+		}
+
+		if (len == 0) {
+			if (op >= max)
+				return 0;
+			dst[op++] = src[ip++];
+		} else {
+			size_t code = len < LZ_MAX_SHORT ? len : LZ_MAX_SHORT;
+
+			if (op + 3 > max)
+				return 0;
+			dst[ctrl] |= 1 << bit;
+			dst[op++] = off & 0xff;
+			dst[op++] = (off >> 8) << 4 | (code - LZ_MIN_MATCH);
+			if (code == LZ_MAX_SHORT)
+				dst[op++] = len - LZ_MAX_SHORT;
+			ip += len;
+		}
+		bit++;
+	}
+	return op;
+}
+
+/* Decompresses LEN bytes at SRC, which lz_compress() produced, into the
+ * page at DST. */
+static void
+lz_decompress (const uint8_t *src, size_t len, uint8_t *dst) {
+	size_t ip = 0, op = 0;
+
+	while (op < PGSIZE) {
+		uint8_t ctrl = src[ip++];
+		int bit;
+
+		for (bit = 0; bit < 8 && op < PGSIZE; bit++) {
+			if (ctrl & (1 << bit)) {
+				size_t off = src[ip] | (size_t) (src[ip + 1] >> 4) << 8;
+				size_t n = (src[ip + 1] & 0xf) + LZ_MIN_MATCH;
+
+				ip += 2;
+				if (n == LZ_MAX_SHORT)
+					n += src[ip++];
+				ASSERT (off > 0 && off <= op && op + n <= PGSIZE);
+				/* Byte by byte: the source may overlap the output. */
+				while (n-- > 0) {
+					dst[op] = dst[op - off];
+					op++;
+				}
+			} else
+				dst[op++] = src[ip++];
+		}
+	}
+	ASSERT (ip == len);
+}
+
+/* Returns true if every byte of the page at KVA equals its first. */
+static bool
+same_filled (const uint8_t *kva) {
+	const uint64_t *w = (const uint64_t *) kva;
+	uint64_t v = w[0];
+	size_t i;
+
+	if (v != kva[0] * 0x0101010101010101ull)
+		return false;
+	for (i = 1; i < PGSIZE / sizeof *w; i++)
+		if (w[i] != v)
+			return false;
+	return true;
+}
+
+static void
+entry_free (struct zswap_entry *e) {
+	list_remove (&e->elem);
+	pool_bytes -= sizeof *e + e->len;
+	e->page->anon.zswap = NULL;
+	free (e);
+}
+
+static void
+entry_load (struct zswap_entry *e, void *kva) {
+	if (e->len == 0)
+		memset (kva, e->fill, PGSIZE);
+	else
+		lz_decompress (e->data, e->len, kva);
+}
+
+/* Writes the coldest entry in the pool to the swap disk and frees it.
+ * Returns false if the swap disk is full. */
+static bool
+writeback_coldest (void) {
+	struct zswap_entry *e = list_entry (list_front (&pool),
+			struct zswap_entry, elem);
+
+	entry_load (e, writeback_buf);
+	if (!anon_swap_write_page (e->page, writeback_buf))
+		return false;
+	entry_free (e);
+	writeback_cnt++;
+	return true;
+}
+
+/* Stores the contents of PAGE, at KVA, in the pool, writing the coldest
+ * entries back to the swap disk as needed to make room.  On success
+ * sets PAGE's zswap entry and returns true.  Returns false if the page
+ * compresses poorly or no room can be made, in which case the caller
+ * writes it to the swap disk itself. */
+bool
+zswap_store (struct page *page, const void *kva) {
+	struct zswap_entry *e;
+	size_t len = 0;
+
+	ASSERT (page->anon.zswap == NULL);
+
+	if (!same_filled (kva)) {
+		len = lz_compress (kva, lz_buf, ZSWAP_MAX_LEN);
+		if (len == 0) {
+			reject_cnt++;
+			return false;
+		}
+	}
+	while (pool_bytes + sizeof *e + len > pool_max) {
+		if (list_empty (&pool) || !writeback_coldest ())
+			return false;
+	}
+
+	e = malloc (sizeof *e + len);
+	if (e == NULL)
+		return false;
+	e->page = page;
+	e->len = len;
+	e->fill = *(const uint8_t *) kva;
+	memcpy (e->data, lz_buf, len);
+	list_push_back (&pool, &e->elem);
+	pool_bytes += sizeof *e + len;
+	page->anon.zswap = e;
+
+	store_cnt++;
+	if (len == 0)
+		same_cnt++;
+	orig_bytes += PGSIZE;
+	comp_bytes += len;
+	return true;
+}
+
+/* Decompresses PAGE's contents from the pool into KVA and drops them
+ * from the pool. */
+void
+zswap_load (struct page *page, void *kva) {
+	struct zswap_entry *e = page->anon.zswap;
+
+	ASSERT (e != NULL && e->page == page);
+	entry_load (e, kva);
+	entry_free (e);
+}
+
+/* Drops PAGE's contents from the pool without reading them. */
+void
+zswap_invalidate (struct page *page) {
+	ASSERT (page->anon.zswap != NULL);
+	entry_free (page->anon.zswap);
+}